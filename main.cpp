@@ -1,10 +1,237 @@
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <string>
 #include <nav_file.h>
 
+namespace {
+	// forwards to the nav_file and counts the adjacency lookups, MicroPather makes one per expanded area
+	// while its neighbour cache is cold
+	class counting_graph : public micropather::Graph {
+	public:
+		counting_graph(nav_mesh::nav_file& nav) : m_nav(nav) { }
 
-int main() {
+		float LeastCostEstimate(void* start, void* end) override { return m_nav.LeastCostEstimate(start, end); }
+
+		void AdjacentCost(void* state, micropather::MPVector< micropather::StateCost >* adjacent) override {
+			m_lookups++;
+			m_nav.AdjacentCost(state, adjacent);
+		}
+
+		void PrintStateInfo(void*) override { }
+
+		nav_mesh::nav_file& m_nav;
+		std::size_t m_lookups = 0;
+	};
+
+	void* get_state(const nav_mesh::nav_file& nav, std::size_t area_index) {
+		return reinterpret_cast<void*>(static_cast<std::uintptr_t>(nav.m_areas[area_index].get_id()));
+	}
+
+	// start and goal area pairs that are connected, the same for every run
+	std::vector< std::pair< std::size_t, std::size_t > > get_bench_pairs(const nav_mesh::nav_file& nav, std::size_t count) {
+		std::mt19937 random(1);
+		std::uniform_int_distribution< std::size_t > area(0, nav.m_areas.size() - 1);
+		std::vector< std::pair< std::size_t, std::size_t > > pairs;
+
+		for (std::size_t tries = 0; pairs.size() < count && tries < count * 100; tries++) {
+			std::size_t start = area(random), goal = area(random);
+			if (start != goal && nav.m_components.may_reach(start, goal))
+				pairs.push_back({ start, goal });
+		}
+
+		return pairs;
+	}
+
+	double get_seconds_since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// MicroPather through the virtual Graph interface against the native search specialized on each cost profile
+	void bench_profiles(const char* file, std::size_t pair_count) {
+		nav_mesh::nav_file nav(file);
+		auto pairs = get_bench_pairs(nav, pair_count);
+		micropather::MPVector< void* > path;
+		float cost = 0.f;
+
+		// expansions of MicroPather, counted with a cold neighbour cache on every query
+		counting_graph graph(nav);
+		micropather::MicroPather counting_pather(&graph, 250, 6, false);
+		for (const auto& [start, goal] : pairs) {
+			counting_pather.Reset();
+			counting_pather.Solve(get_state(nav, start), get_state(nav, goal), &path, &cost);
+		}
+
+		// timed like find_path uses it, the neighbour cache stays warm between queries
+		micropather::MicroPather pather(&nav, 250, 6, false);
+		auto time = std::chrono::steady_clock::now();
+		for (const auto& [start, goal] : pairs)
+			pather.Solve(get_state(nav, start), get_state(nav, goal), &path, &cost);
+		double seconds = get_seconds_since(time);
+
+		std::cout << "micropather (virtual): " << pairs.size() / seconds << " queries/s, " << graph.m_lookups / seconds
+			<< " expansions/s, " << graph.m_lookups / std::max< std::size_t >(pairs.size(), 1) << " expansions/query\n";
+
+		const std::pair< nav_mesh::nav_cost_profile, const char* > profiles[] = {
+			{ nav_mesh::nav_cost_profile::distance, "distance" },
+			{ nav_mesh::nav_cost_profile::attribute_weighted, "attribute_weighted" },
+			{ nav_mesh::nav_cost_profile::time, "time" }
+		};
+
+		nav_mesh::nav_search_context context;
+		for (const auto& [profile, name] : profiles) {
+			nav_mesh::nav_path_options_t options;
+			options.profile = profile;
+			options.use_path_cache = false;
+
+			std::size_t expansions = 0;
+			time = std::chrono::steady_clock::now();
+			for (const auto& [start, goal] : pairs) {
+				nav_mesh::nav_path_stats_t stats;
+				nav.solve_path(context, start, goal, options, &stats);
+				expansions += stats.expansions;
+			}
+			seconds = get_seconds_since(time);
+
+			std::cout << "native " << name << ": " << pairs.size() / seconds << " queries/s, " << expansions / seconds
+				<< " expansions/s, " << expansions / std::max< std::size_t >(pairs.size(), 1) << " expansions/query\n";
+		}
+	}
+
+	// the same searches on the mesh loaded in every area order. pairs are picked by area id, so they stay the
+	// same whatever the order makes of the indices
+	void bench_orders(const char* file, std::size_t pair_count) {
+		std::vector< std::pair< std::uint32_t, std::uint32_t > > id_pairs;
+		{
+			nav_mesh::nav_file nav(file);
+			for (const auto& [start, goal] : get_bench_pairs(nav, pair_count))
+				id_pairs.push_back({ nav.m_areas[start].get_id(), nav.m_areas[goal].get_id() });
+		}
+
+		const std::pair< nav_mesh::nav_area_order, const char* > orders[] = {
+			{ nav_mesh::nav_area_order::file, "file" },
+			{ nav_mesh::nav_area_order::hilbert, "hilbert" },
+			{ nav_mesh::nav_area_order::reverse_cuthill_mckee, "reverse_cuthill_mckee" }
+		};
+
+		for (const auto& [order, name] : orders) {
+			nav_mesh::nav_file nav(file, order);
+			nav_mesh::nav_search_context context;
+			nav_mesh::nav_path_options_t options;
+			options.use_path_cache = false;
+
+			// best of a few rounds, the first one also warms the caches
+			double best_seconds = 1e30;
+			std::size_t expansions = 0;
+			for (int round = 0; round < 5; round++) {
+				expansions = 0;
+				auto time = std::chrono::steady_clock::now();
+				for (const auto& [start, goal] : id_pairs) {
+					nav_mesh::nav_path_stats_t stats;
+					nav.solve_path(context, nav.get_area_index(start), nav.get_area_index(goal), options, &stats);
+					expansions += stats.expansions;
+				}
+				best_seconds = std::min(best_seconds, get_seconds_since(time));
+			}
+
+			std::cout << name << ": " << id_pairs.size() / best_seconds << " queries/s, " << expansions / best_seconds
+				<< " expansions/s\n";
+		}
+	}
+
+	// best of a few rounds over the pairs, adding up expansions and costs of the last one
+	double time_searches(const nav_mesh::nav_file& nav, const std::vector< std::pair< std::size_t, std::size_t > >& pairs,
+		const nav_mesh::nav_path_options_t& options, std::size_t& expansions, std::vector< float >& costs) {
+		nav_mesh::nav_search_context context;
+		double best_seconds = 1e30;
+
+		for (int round = 0; round < 5; round++) {
+			expansions = 0;
+			costs.clear();
+			auto time = std::chrono::steady_clock::now();
+			for (const auto& [start, goal] : pairs) {
+				nav_mesh::nav_path_stats_t stats;
+				nav.solve_path(context, start, goal, options, &stats);
+				expansions += stats.expansions;
+				costs.push_back(stats.cost);
+			}
+			best_seconds = std::min(best_seconds, get_seconds_since(time));
+		}
+
+		return best_seconds;
+	}
+
+	// the full search against the one restricted to the coarse corridor, for every mesh given
+	void bench_coarse(const std::vector< const char* >& files, std::size_t pair_count) {
+		for (const char* file : files) {
+			nav_mesh::nav_file nav(file);
+			auto pairs = get_bench_pairs(nav, pair_count);
+			std::size_t count = std::max< std::size_t >(pairs.size(), 1);
+
+			nav_mesh::nav_path_options_t options;
+			options.use_path_cache = false;
+
+			std::size_t full_expansions = 0;
+			std::vector< float > full_costs;
+			double full_seconds = time_searches(nav, pairs, options, full_expansions, full_costs);
+
+			auto time = std::chrono::steady_clock::now();
+			nav.build_coarse_graph();
+			double build_seconds = get_seconds_since(time);
+
+			options.use_coarse_graph = true;
+			std::size_t coarse_expansions = 0;
+			std::vector< float > coarse_costs;
+			double coarse_seconds = time_searches(nav, pairs, options, coarse_expansions, coarse_costs);
+
+			// the corridor gives up optimality, so report how much longer its paths come out
+			double cost_ratio = 0.0, worst_cost_ratio = 1.0;
+			for (std::size_t i = 0; i < pairs.size(); i++) {
+				double ratio = full_costs[i] > 0.f ? coarse_costs[i] / full_costs[i] : 1.0;
+				cost_ratio += ratio;
+				worst_cost_ratio = std::max(worst_cost_ratio, ratio);
+			}
+
+			const nav_mesh::nav_coarse_stats_t& stats = nav.m_coarse_graph.get_stats();
+			std::cout << file << ": " << stats.area_count << " areas in " << stats.node_count << " nodes, built in "
+				<< build_seconds * 1000.0 << " ms\n";
+			std::cout << "  full: " << pairs.size() / full_seconds << " queries/s, " << full_expansions / count << " expansions/query\n";
+			std::cout << "  coarse: " << pairs.size() / coarse_seconds << " queries/s, " << coarse_expansions / count << " expansions/query\n";
+			std::cout << "  speedup " << full_seconds / coarse_seconds << "x, cost " << cost_ratio / count << "x on average, "
+				<< worst_cost_ratio << "x at worst\n";
+		}
+	}
+}
+
+// nav_parse [--bench-profiles | --bench-orders file.nav [pairs] | --bench-coarse file.nav... [pairs]]
+int main(int argc, char** argv) {
 	try {
+		if (argc >= 3 && std::strcmp(argv[1], "--bench-profiles") == 0) {
+			bench_profiles(argv[2], argc >= 4 ? std::stoul(argv[3]) : 1000);
+			return 0;
+		}
+
+		if (argc >= 3 && std::strcmp(argv[1], "--bench-orders") == 0) {
+			bench_orders(argv[2], argc >= 4 ? std::stoul(argv[3]) : 1000);
+			return 0;
+		}
+
+		if (argc >= 3 && std::strcmp(argv[1], "--bench-coarse") == 0) {
+			// a last argument of only digits is the pair count, everything else a mesh
+			std::vector< const char* > files(argv + 2, argv + argc);
+			std::size_t pair_count = 1000;
+			if (files.size() > 1 && std::all_of(files.back(), files.back() + std::strlen(files.back()),
+				[](char c) { return c >= '0' && c <= '9'; })) {
+				pair_count = std::stoul(files.back());
+				files.pop_back();
+			}
+
+			bench_coarse(files, pair_count);
+			return 0;
+		}
+
 		nav_mesh::nav_file map_nav(".nav");
 
 		nav_mesh::vec3_t start_point = { -1917, 11169, -127 };
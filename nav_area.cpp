@@ -23,6 +23,17 @@ namespace nav_mesh {
 		return true;
 	}
 
+	float nav_area::get_z(float x, float y) const {
+		// degenerate areas have zero inverse extents and come out flat at the nw height
+		float u = std::clamp((x - m_nw_corner.x) * m_inv_dx_corners, 0.f, 1.f);
+		float v = std::clamp((y - m_nw_corner.y) * m_inv_dy_corners, 0.f, 1.f);
+
+		float north_z = m_nw_corner.z + u * (m_ne_z - m_nw_corner.z);
+		float south_z = m_sw_z + u * (m_se_corner.z - m_sw_z);
+
+		return north_z + v * (south_z - north_z);
+	}
+
 	bool nav_area::is_within_3d(vec3_t position, float z_tolerance) const {
 		if (position.x < m_nw_corner.x)
 			return false;
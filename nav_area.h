@@ -45,6 +45,10 @@ namespace nav_mesh {
 
         bool is_within(vec3_t position) const;
 
+        // ground height at x, y, interpolated bilinearly between the four corner heights. points outside the
+        // area are clamped onto its edges
+        float get_z(float x, float y) const;
+
         // max obstacle distance is 18 - https://developer.valvesoftware.com/wiki/Dimensions#Ground_Obstacle_Height
         // 1085->8964 requires large enough (cat mid ledge to cat) - 50 too big
         // 7574 ->7555 requires small enough (cat stairs) - 18 too small
@@ -69,6 +73,7 @@ namespace nav_mesh {
         std::vector< nav_hiding_spot > m_hiding_spots = { };
         std::vector< nav_spot_encounter_t > m_spot_encounters = { };
         std::vector< nav_ladder_connect_t > m_ladder_connections[2] = { };
+        // emptied by nav_file::load once nav_file::m_visibility holds it
         std::vector< nav_area_bind_info_t > m_potentially_visible_areas = { };
     };
 }
\ No newline at end of file
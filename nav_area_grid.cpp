@@ -0,0 +1,235 @@
+#include "nav_area_grid.h"
+#include "nav_file.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NAV_AREA_GRID_SSE2
+#endif
+
+namespace nav_mesh {
+    void nav_area_grid::build(const nav_file& nav) {
+        std::size_t area_count = nav.m_areas.size();
+
+        m_ground.clear();
+        for (const auto& area : nav.m_areas) {
+            m_ground.push_back({ area.m_nw_corner.x, area.m_nw_corner.y, area.m_se_corner.x, area.m_se_corner.y,
+                area.m_inv_dx_corners, area.m_inv_dy_corners, area.m_nw_corner.z, area.m_ne_z, area.m_sw_z, area.m_se_corner.z });
+        }
+
+        float max_x = 0.f, max_y = 0.f, total_size = 0.f;
+        m_min_x = m_min_y = 0.f;
+        if (!m_ground.empty()) {
+            m_min_x = m_ground[0].min_x;
+            m_min_y = m_ground[0].min_y;
+            max_x = m_ground[0].max_x;
+            max_y = m_ground[0].max_y;
+        }
+
+        for (const auto& ground : m_ground) {
+            m_min_x = std::min(m_min_x, ground.min_x);
+            m_min_y = std::min(m_min_y, ground.min_y);
+            max_x = std::max(max_x, ground.max_x);
+            max_y = std::max(max_y, ground.max_y);
+            total_size += (ground.max_x - ground.min_x) + (ground.max_y - ground.min_y);
+        }
+
+        // cells about the size of an average area keep both the areas per cell and the cells per area low,
+        // growing where that would make the grid much larger than the area count
+        float cell_size = std::max(total_size / (2.f * std::max< std::size_t >(area_count, 1)), 16.f);
+        std::size_t max_cells = std::max< std::size_t >(1024, area_count * 4);
+        for (;;) {
+            m_cells_x = static_cast<std::size_t>((max_x - m_min_x) / cell_size) + 1;
+            m_cells_y = static_cast<std::size_t>((max_y - m_min_y) / cell_size) + 1;
+            if (m_cells_x * m_cells_y <= max_cells)
+                break;
+
+            cell_size *= 2.f;
+        }
+
+        m_inv_cell_size = 1.f / cell_size;
+
+        // two passes over the cells each area overlaps, counting and then filling
+        m_cell_start.assign(m_cells_x * m_cells_y + 1, 0);
+        m_cell_areas.resize(0);
+
+        auto for_each_cell = [&](const nav_area_ground_t& ground, auto&& visit) {
+            std::size_t first = get_cell(ground.min_x, ground.min_y),
+                last = get_cell(ground.max_x, ground.max_y);
+
+            for (std::size_t y = first / m_cells_x; y <= last / m_cells_x; y++) {
+                for (std::size_t x = first % m_cells_x; x <= last % m_cells_x; x++)
+                    visit(y * m_cells_x + x);
+            }
+        };
+
+        for (const auto& ground : m_ground)
+            for_each_cell(ground, [&](std::size_t cell) { m_cell_start[cell + 1]++; });
+
+        for (std::size_t i = 1; i < m_cell_start.size(); i++)
+            m_cell_start[i] += m_cell_start[i - 1];
+
+        m_cell_areas.resize(m_cell_start.back());
+        std::vector< std::uint32_t > fill(m_cell_start.begin(), m_cell_start.end() - 1);
+        for (std::size_t area_index = 0; area_index < area_count; area_index++) {
+            for_each_cell(m_ground[area_index], [&](std::size_t cell) {
+                m_cell_areas[fill[cell]++] = static_cast<std::uint32_t>(area_index);
+            });
+        }
+    }
+
+    std::size_t nav_area_grid::get_cell(float x, float y) const {
+        auto clamp_cell = [&](float offset, std::size_t cells) {
+            float cell = std::floor(offset * m_inv_cell_size);
+            return cell <= 0.f ? std::size_t(0) : std::min(static_cast<std::size_t>(cell), cells - 1);
+        };
+
+        return clamp_cell(y - m_min_y, m_cells_y) * m_cells_x + clamp_cell(x - m_min_x, m_cells_x);
+    }
+
+    float nav_area_grid::get_z(const nav_area_ground_t& ground, float x, float y) {
+        // same interpolation as nav_area::get_z
+        float u = std::clamp((x - ground.min_x) * ground.inv_dx, 0.f, 1.f);
+        float v = std::clamp((y - ground.min_y) * ground.inv_dy, 0.f, 1.f);
+
+        float north_z = ground.nw_z + u * (ground.ne_z - ground.nw_z);
+        float south_z = ground.sw_z + u * (ground.se_z - ground.sw_z);
+
+        return north_z + v * (south_z - north_z);
+    }
+
+    std::uint32_t nav_area_grid::get_ground_area(vec3_t position, float step_height, float* ground_z) const {
+        if (m_cell_start.empty())
+            return NAV_INVALID_INDEX;
+
+        std::size_t cell = get_cell(position.x, position.y);
+        std::uint32_t best = NAV_INVALID_INDEX;
+        float best_z = -FLT_MAX;
+
+        for (std::uint32_t i = m_cell_start[cell]; i < m_cell_start[cell + 1]; i++) {
+            const nav_area_ground_t& ground = m_ground[m_cell_areas[i]];
+            if (position.x < ground.min_x || position.x > ground.max_x || position.y < ground.min_y || position.y > ground.max_y)
+                continue;
+
+            float z = get_z(ground, position.x, position.y);
+            if (z <= position.z + step_height && z > best_z) {
+                best_z = z;
+                best = m_cell_areas[i];
+            }
+        }
+
+        if (ground_z && best != NAV_INVALID_INDEX)
+            *ground_z = best_z;
+
+        return best;
+    }
+
+    std::size_t nav_area_grid::get_containing_areas(float x, float y, std::uint32_t& first_area) const {
+        std::size_t cell = get_cell(x, y);
+        std::size_t containing_count = 0;
+
+        for (std::uint32_t i = m_cell_start[cell]; i < m_cell_start[cell + 1] && containing_count < 2; i++) {
+            const nav_area_ground_t& ground = m_ground[m_cell_areas[i]];
+            if (x < ground.min_x || x > ground.max_x || y < ground.min_y || y > ground.max_y)
+                continue;
+
+            if (containing_count++ == 0)
+                first_area = m_cell_areas[i];
+        }
+
+        return containing_count;
+    }
+
+    std::size_t nav_area_grid::get_ground_z(const vec3_t* positions, std::size_t count, float* z, std::uint32_t* area_indices,
+        float step_height) const {
+        std::size_t found_count = 0;
+        std::size_t i = 0;
+
+#ifdef NAV_AREA_GRID_SSE2
+        // most points are over a single floor, those only need bounds tests up front and get their heights
+        // four at a time. stacked floors take the scalar path, lanes off the mesh or done already run as a
+        // flat area at the height of the point and are masked out at the end
+        if (!m_cell_start.empty()) {
+            for (; i + 4 <= count; i += 4) {
+                alignas(16) float min_x[4], min_y[4], inv_dx[4], inv_dy[4], nw[4], ne[4], sw[4], se[4];
+                std::uint32_t lane_areas[4];
+                bool stacked[4];
+
+                for (std::size_t lane = 0; lane < 4; lane++) {
+                    const vec3_t& position = positions[i + lane];
+                    nav_area_ground_t ground = { position.x, position.y, position.x, position.y, 0.f, 0.f,
+                        position.z, position.z, position.z, position.z };
+
+                    std::uint32_t area_index = NAV_INVALID_INDEX;
+                    std::size_t containing_count = get_containing_areas(position.x, position.y, area_index);
+                    stacked[lane] = containing_count > 1;
+
+                    if (containing_count == 1)
+                        ground = m_ground[area_index];
+                    else
+                        area_index = NAV_INVALID_INDEX;
+
+                    lane_areas[lane] = area_index;
+                    min_x[lane] = ground.min_x;
+                    min_y[lane] = ground.min_y;
+                    inv_dx[lane] = ground.inv_dx;
+                    inv_dy[lane] = ground.inv_dy;
+                    nw[lane] = ground.nw_z;
+                    ne[lane] = ground.ne_z;
+                    sw[lane] = ground.sw_z;
+                    se[lane] = ground.se_z;
+                }
+
+                __m128 x = _mm_set_ps(positions[i + 3].x, positions[i + 2].x, positions[i + 1].x, positions[i].x);
+                __m128 y = _mm_set_ps(positions[i + 3].y, positions[i + 2].y, positions[i + 1].y, positions[i].y);
+                __m128 limit = _mm_set_ps(positions[i + 3].z, positions[i + 2].z, positions[i + 1].z, positions[i].z);
+                limit = _mm_add_ps(limit, _mm_set1_ps(step_height));
+                __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+
+                __m128 u = _mm_mul_ps(_mm_sub_ps(x, _mm_load_ps(min_x)), _mm_load_ps(inv_dx));
+                __m128 v = _mm_mul_ps(_mm_sub_ps(y, _mm_load_ps(min_y)), _mm_load_ps(inv_dy));
+                u = _mm_min_ps(_mm_max_ps(u, zero), one);
+                v = _mm_min_ps(_mm_max_ps(v, zero), one);
+
+                __m128 nw_z = _mm_load_ps(nw), sw_z = _mm_load_ps(sw);
+                __m128 north_z = _mm_add_ps(nw_z, _mm_mul_ps(u, _mm_sub_ps(_mm_load_ps(ne), nw_z)));
+                __m128 south_z = _mm_add_ps(sw_z, _mm_mul_ps(u, _mm_sub_ps(_mm_load_ps(se), sw_z)));
+                __m128 ground_z = _mm_add_ps(north_z, _mm_mul_ps(v, _mm_sub_ps(south_z, north_z)));
+
+                alignas(16) float lane_z[4];
+                _mm_store_ps(lane_z, ground_z);
+                int below_limit = _mm_movemask_ps(_mm_cmple_ps(ground_z, limit));
+
+                for (std::size_t lane = 0; lane < 4; lane++) {
+                    std::size_t point = i + lane;
+                    std::uint32_t area_index = lane_areas[lane];
+
+                    if (stacked[lane])
+                        area_index = get_ground_area(positions[point], step_height, lane_z + lane);
+                    else if ((below_limit & (1 << lane)) == 0)
+                        area_index = NAV_INVALID_INDEX;
+
+                    if (area_indices)
+                        area_indices[point] = area_index;
+
+                    z[point] = area_index == NAV_INVALID_INDEX ? positions[point].z : lane_z[lane];
+                    found_count += area_index != NAV_INVALID_INDEX;
+                }
+            }
+        }
+#endif
+
+        for (; i < count; i++) {
+            std::uint32_t area_index = get_ground_area(positions[i], step_height, z + i);
+            if (area_indices)
+                area_indices[i] = area_index;
+
+            if (area_index == NAV_INVALID_INDEX)
+                z[i] = positions[i].z;
+            else
+                found_count++;
+        }
+
+        return found_count;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "nav_query.h"
+#include <cstdint>
+#include <vector>
+
+namespace nav_mesh {
+    class nav_file;
+
+    // how far above a point a floor may still be to count as the ground under it, the max ground obstacle height
+    constexpr float NAV_GROUND_STEP_HEIGHT = 18.f;
+
+    // what get_z needs of an area, packed so the batch query reads one line per point
+    struct nav_area_ground_t {
+        float min_x, min_y,
+            max_x, max_y,
+            inv_dx, inv_dy,
+            nw_z, ne_z,
+            sw_z, se_z;
+    };
+
+    /*
+     *	Uniform 2d grid over the areas, each cell listing the indices of the areas overlapping it, for
+     *	finding the area under a point without scanning every area. Indexed like m_areas, so it is
+     *	built after the areas got their final order.
+     */
+    class nav_area_grid {
+    public:
+        void build(const nav_file& nav);
+
+        // area containing x, y whose floor is the highest one at most step_height above position.z,
+        // NAV_INVALID_INDEX if there is none. ground_z, if given, receives the height of that floor
+        std::uint32_t get_ground_area(vec3_t position, float step_height = NAV_GROUND_STEP_HEIGHT, float* ground_z = nullptr) const;
+
+        // ground height under every position, four points at a time. points off the mesh keep their own z and
+        // get NAV_INVALID_INDEX in area_indices, if given. returns how many points were on the mesh
+        std::size_t get_ground_z(const vec3_t* positions, std::size_t count, float* z, std::uint32_t* area_indices = nullptr,
+            float step_height = NAV_GROUND_STEP_HEIGHT) const;
+
+        static float get_z(const nav_area_ground_t& ground, float x, float y);
+
+    private:
+        std::size_t get_cell(float x, float y) const;
+        // number of areas containing x, y, counting stops at 2. first_area receives the first one
+        std::size_t get_containing_areas(float x, float y, std::uint32_t& first_area) const;
+
+        float m_min_x = 0.f,
+            m_min_y = 0.f,
+            m_inv_cell_size = 0.f;
+
+        std::size_t m_cells_x = 0,
+            m_cells_y = 0;
+
+        std::vector< nav_area_ground_t > m_ground = { };
+        // areas overlapping cell i are m_cell_areas[m_cell_start[i], m_cell_start[i + 1])
+        std::vector< std::uint32_t > m_cell_start = { },
+            m_cell_areas = { };
+    };
+}
@@ -0,0 +1,246 @@
+#include "nav_async.h"
+#include "nav_file.h"
+#include <algorithm>
+
+namespace nav_mesh {
+    struct nav_path_job_t {
+        std::size_t start = 0,
+            goal = 0;
+
+        nav_path_cache_key_t key = { };
+        nav_path_options_t options = { };
+
+        // guarded by the mutex of the workers
+        nav_request_priority priority = nav_request_priority::low;
+        bool started = false;
+        std::vector< std::shared_ptr< nav_path_waiter_t > > waiters = { };
+
+        // requests not cancelled yet, once this drops to 0 nobody can join and the search is abandoned
+        std::atomic< std::size_t > live_waiters = { 1 };
+        std::atomic< bool > cancelled = { false };
+    };
+
+    void nav_path_request::cancel() {
+        if (!m_waiter || m_waiter->cancelled.exchange(true))
+            return;
+
+        if (m_waiter->job->live_waiters.fetch_sub(1) == 1)
+            m_waiter->job->cancelled = true;
+    }
+
+    nav_path_workers::nav_path_workers(const nav_file& nav, std::size_t thread_count)
+        : m_nav(nav), m_thread_count(thread_count) {
+        // leave half the machine to the game by default
+        if (m_thread_count == 0)
+            m_thread_count = std::max< std::size_t >(1, std::thread::hardware_concurrency() / 2);
+    }
+
+    nav_path_workers::~nav_path_workers() {
+        {
+            std::lock_guard< std::mutex > lock(m_mutex);
+            m_stopping = true;
+
+            for (auto& [key, job] : m_in_flight)
+                job->cancelled = true;
+        }
+
+        m_wake.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+
+        // whatever was still queued resolves as cancelled
+        while (!m_queue.empty()) {
+            std::shared_ptr< nav_path_job_t > job = m_queue.top().job;
+            m_queue.pop();
+
+            if (job->started)
+                continue;
+
+            job->started = true;
+            for (auto& waiter : job->waiters) {
+                nav_path_result_t result;
+                result.cancelled = true;
+                waiter->promise.set_value(std::move(result));
+            }
+        }
+    }
+
+    nav_path_request nav_path_workers::request_path(vec3_t from, vec3_t to, const nav_path_options_t& options,
+        nav_request_priority priority, nav_path_callback callback) {
+        auto waiter = std::make_shared< nav_path_waiter_t >();
+        waiter->from = from;
+        waiter->to = to;
+        waiter->output = options.output;
+        waiter->callback = std::move(callback);
+
+        nav_path_request request;
+        request.m_future = waiter->promise.get_future();
+        request.m_waiter = waiter;
+
+        std::size_t start = m_nav.get_area_index(m_nav.get_nearest_area_by_position(from));
+        std::size_t goal = m_nav.get_area_index(m_nav.get_nearest_area_by_position(to));
+        nav_path_cache_key_t key = m_nav.get_path_cache_key(start, goal, options);
+
+        std::lock_guard< std::mutex > lock(m_mutex);
+        if (m_threads.empty())
+            start_threads();
+
+        std::shared_ptr< nav_path_job_t > job = nullptr;
+        auto found = m_in_flight.find(key);
+
+        // the budget and the caller's cancel flag decide whether a partial path comes back, so only requests
+        // equal in both share a search
+        if (found != m_in_flight.end() && found->second->options.max_expansions == options.max_expansions &&
+            found->second->options.deadline == options.deadline && found->second->options.cancelled == options.cancelled) {
+            std::size_t live_waiters = found->second->live_waiters;
+            while (live_waiters != 0 && !found->second->live_waiters.compare_exchange_weak(live_waiters, live_waiters + 1)) { }
+
+            if (live_waiters != 0)
+                job = found->second;
+        }
+
+        bool queue_job = false;
+        if (!job) {
+            job = std::make_shared< nav_path_job_t >();
+            job->start = start;
+            job->goal = goal;
+            job->key = key;
+            job->options = options;
+            job->priority = priority;
+            m_in_flight[key] = job;
+            queue_job = true;
+        }
+        else if (!job->started && priority > job->priority) {
+            job->priority = priority;
+            queue_job = true;
+        }
+
+        waiter->job = job;
+        job->waiters.push_back(waiter);
+
+        if (queue_job) {
+            m_queue.push({ priority, m_sequence++, job });
+            m_wake.notify_one();
+        }
+
+        return request;
+    }
+
+    std::size_t nav_path_workers::get_queued_count() const {
+        std::lock_guard< std::mutex > lock(m_mutex);
+
+        std::size_t queued_count = 0;
+        for (const auto& [key, job] : m_in_flight) {
+            if (!job->started)
+                queued_count += job->waiters.size();
+        }
+
+        return queued_count;
+    }
+
+    void nav_path_workers::start_threads() {
+        for (std::size_t i = 0; i < m_thread_count; i++)
+            m_threads.emplace_back(&nav_path_workers::run, this);
+    }
+
+    void nav_path_workers::run() {
+        nav_search_context context;
+
+        for (;;) {
+            std::shared_ptr< nav_path_job_t > job = nullptr;
+
+            {
+                std::unique_lock< std::mutex > lock(m_mutex);
+                m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+
+                if (m_stopping)
+                    return;
+
+                job = m_queue.top().job;
+                m_queue.pop();
+
+                if (job->started)
+                    continue;
+
+                job->started = true;
+            }
+
+            run_job(*job, context);
+        }
+    }
+
+    void nav_path_workers::run_job(nav_path_job_t& job, nav_search_context& context) {
+        nav_path_status status = nav_path_status::no_solution;
+        nav_path_stats_t stats = { };
+        std::exception_ptr error = nullptr;
+
+        if (!job.cancelled) {
+            try {
+                if (job.start == job.goal) {
+                    status = nav_path_status::start_end_same;
+                    stats.cost = 0.f;
+                }
+                else if (m_nav.m_components.may_reach(job.start, job.goal)) {
+                    status = m_nav.solve_path(context, job.start, job.goal, job.options, &stats, &job.cancelled);
+                }
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        // the search only gives up early when every request left it
+        bool abandoned = job.cancelled;
+
+        // off the map nobody can join anymore, so the waiters are final
+        std::vector< std::shared_ptr< nav_path_waiter_t > > waiters;
+        {
+            std::lock_guard< std::mutex > lock(m_mutex);
+
+            auto found = m_in_flight.find(job.key);
+            if (found != m_in_flight.end() && found->second.get() == &job)
+                m_in_flight.erase(found);
+
+            waiters.swap(job.waiters);
+        }
+
+        for (auto& waiter : waiters) {
+            if (error) {
+                waiter->promise.set_exception(error);
+                continue;
+            }
+
+            nav_path_result_t result;
+            if (abandoned || waiter->cancelled) {
+                result.cancelled = true;
+                waiter->promise.set_value(std::move(result));
+                continue;
+            }
+
+            result.status = status;
+            result.stats = stats;
+
+            if (status == nav_path_status::start_end_same) {
+                result.path.push_back(waiter->to);
+            }
+            else if (status != nav_path_status::no_solution) {
+                // the area sequence is shared, the ends and the output form are per request
+                nav_path_options_t options = job.options;
+                options.output = waiter->output;
+                m_nav.build_path_output(context, status, waiter->from, waiter->to, options, result.path);
+            }
+
+            // a throwing callback fails its own request, the waiters after it still get their paths
+            try {
+                if (waiter->callback)
+                    waiter->callback(result);
+            }
+            catch (...) {
+                waiter->promise.set_exception(std::current_exception());
+                continue;
+            }
+
+            waiter->promise.set_value(std::move(result));
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "nav_path_cache.h"
+#include "nav_query.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace nav_mesh {
+    class nav_file;
+
+    enum class nav_request_priority : std::uint8_t {
+        low,
+        normal,
+        high
+    };
+
+    struct nav_path_result_t {
+        nav_path_status status = nav_path_status::no_solution;
+        std::vector< vec3_t > path = { };
+        nav_path_stats_t stats = { };
+        // the request was cancelled before its path was written, nothing else is set
+        bool cancelled = false;
+    };
+
+    // runs on the worker before the future is resolved. an exception it throws resolves the future of its own request
+    using nav_path_callback = std::function< void(const nav_path_result_t&) >;
+
+    struct nav_path_job_t;
+
+    struct nav_path_waiter_t {
+        vec3_t from = { },
+            to = { };
+
+        nav_path_output output = nav_path_output::area_centers;
+        std::promise< nav_path_result_t > promise = { };
+        nav_path_callback callback = { };
+        std::atomic< bool > cancelled = { false };
+        std::shared_ptr< nav_path_job_t > job = { };
+    };
+
+    /*
+     *	Handle of one asynchronous path request. Cancelling it resolves the future with a
+     *	cancelled result and skips the callback, and the search itself is abandoned once no
+     *	other request is waiting on it. A cancel flag in the options of the request still works
+     *	as it does for find_path: the search stops early and the result holds a partial path.
+     */
+    class nav_path_request {
+    public:
+        void cancel();
+        bool is_cancelled() const { return m_waiter && m_waiter->cancelled; }
+
+        // may be taken once, like any std::future
+        std::future< nav_path_result_t > m_future = { };
+        std::shared_ptr< nav_path_waiter_t > m_waiter = { };
+    };
+
+    /*
+     *	Worker pool answering find_path requests off the calling thread. Requests for the same start
+     *	and goal area with the same options share one search while it is queued or running, each
+     *	still getting a path to its own end points. Higher priorities are searched first, requests
+     *	of the same priority in the order they came in. Threads are started on the first request.
+     */
+    class nav_path_workers {
+    public:
+        nav_path_workers(const nav_file& nav, std::size_t thread_count = 0);
+        ~nav_path_workers();
+
+        nav_path_workers(const nav_path_workers&) = delete;
+        nav_path_workers& operator=(const nav_path_workers&) = delete;
+
+        // the options are copied, but an overlay in them must outlive the request
+        nav_path_request request_path(vec3_t from, vec3_t to, const nav_path_options_t& options = { },
+            nav_request_priority priority = nav_request_priority::normal, nav_path_callback callback = { });
+
+        // requests that have not been picked up by a worker yet
+        std::size_t get_queued_count() const;
+
+    private:
+        struct queue_entry_t {
+            nav_request_priority priority;
+            std::uint64_t sequence;
+            std::shared_ptr< nav_path_job_t > job;
+
+            bool operator<(const queue_entry_t& other) const {
+                if (priority != other.priority)
+                    return priority < other.priority;
+
+                return sequence > other.sequence;
+            }
+        };
+
+        void start_threads();
+        void run();
+        void run_job(nav_path_job_t& job, nav_search_context& context);
+
+        const nav_file& m_nav;
+        std::size_t m_thread_count;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+        std::uint64_t m_sequence = 0;
+
+        // a job is queued again when a request with a higher priority joins it, stale entries are skipped
+        std::priority_queue< queue_entry_t > m_queue;
+        std::unordered_map< nav_path_cache_key_t, std::shared_ptr< nav_path_job_t >, nav_path_cache_key_hash_t > m_in_flight;
+        std::vector< std::thread > m_threads;
+    };
+}
@@ -30,5 +30,16 @@ namespace nav_mesh {
 
 	void nav_buffer::clear() {
 		m_nav_buffer.clear();
+		m_bytes_read = 0;
+	}
+
+	std::uint64_t nav_buffer::get_hash() const {
+		std::uint64_t h = 14695981039346656037ULL;
+		for (std::uint8_t byte : m_nav_buffer) {
+			h ^= byte;
+			h *= 1099511628211ULL;
+		}
+
+		return h;
 	}
 }
\ No newline at end of file
@@ -14,6 +14,11 @@ namespace nav_mesh {
 
 		void clear();
 
+		// FNV-1a of the whole loaded file, identifies a map independent of its file name
+		std::uint64_t get_hash() const;
+
+		std::size_t get_remaining() const { return m_nav_buffer.size() - m_bytes_read; }
+
 		/*
 		 *	The reason we don't erase the read bytes from the buffer is performance.
 		 *	Benchmarks tested on cs_militia.nav:
@@ -0,0 +1,223 @@
+#include "nav_coarse_graph.h"
+#include "nav_file.h"
+#include "nav_search.h"
+#include <numeric>
+
+namespace nav_mesh {
+    namespace {
+        struct nav_merge_candidate_t {
+            float size;
+            std::uint32_t a, b;
+
+            bool operator<(const nav_merge_candidate_t& other) const { return size < other.size; }
+        };
+
+        // xy bounds and member count of a cluster, kept on its root
+        struct nav_cluster_t {
+            float min_x, min_y,
+                max_x, max_y;
+            std::size_t area_count;
+        };
+
+        std::uint32_t find_root(std::vector< std::uint32_t >& parents, std::uint32_t area_index) {
+            while (parents[area_index] != area_index) {
+                parents[area_index] = parents[parents[area_index]];
+                area_index = parents[area_index];
+            }
+
+            return area_index;
+        }
+    }
+
+    void nav_coarse_graph::build(const nav_file& nav) {
+        std::size_t area_count = nav.m_areas.size();
+        constexpr std::uint32_t no_merge = static_cast<std::uint32_t>(NavAttributeType::NAV_MESH_NO_MERGE);
+
+        auto get_size = [&](std::size_t area_index) {
+            const nav_area& area = nav.m_areas[area_index];
+            return std::max(area.m_se_corner.x - area.m_nw_corner.x, area.m_se_corner.y - area.m_nw_corner.y);
+        };
+
+        auto is_compatible = [&](std::size_t a, std::size_t b) {
+            const nav_area& area = nav.m_areas[a];
+            const nav_area& other = nav.m_areas[b];
+
+            return area.m_attribute_flags == other.m_attribute_flags && area.m_place == other.m_place &&
+                (area.m_attribute_flags & no_merge) == 0 && std::fabs(area.get_center().z - other.get_center().z) <= NAV_GROUND_STEP_HEIGHT;
+        };
+
+        // every pair walkable both ways with a small area in it, listed once
+        std::vector< nav_merge_candidate_t > candidates;
+        for (std::size_t a = 0; a < area_count; a++) {
+            std::size_t first = nav.connections_area_start[a],
+                last = first + nav.connections_area_length[a];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::size_t b = nav.connections[i];
+                if (b <= a || nav.connections_kind[i] != nav_connection_kind::walk || (get_size(a) > NAV_COARSE_SMALL_AREA_SIZE && get_size(b) > NAV_COARSE_SMALL_AREA_SIZE))
+                    continue;
+
+                if (!is_compatible(a, b) || nav.find_connection(b, a) == NAV_INVALID_INDEX)
+                    continue;
+
+                candidates.push_back({ get_size(a) + get_size(b), static_cast<std::uint32_t>(a), static_cast<std::uint32_t>(b) });
+            }
+        }
+
+        std::stable_sort(candidates.begin(), candidates.end());
+
+        std::vector< std::uint32_t > parents(area_count);
+        std::iota(parents.begin(), parents.end(), 0);
+
+        std::vector< nav_cluster_t > clusters(area_count);
+        for (std::size_t i = 0; i < area_count; i++) {
+            const nav_area& area = nav.m_areas[i];
+            clusters[i] = { area.m_nw_corner.x, area.m_nw_corner.y, area.m_se_corner.x, area.m_se_corner.y, 1 };
+        }
+
+        for (const auto& candidate : candidates) {
+            std::uint32_t root_a = find_root(parents, candidate.a),
+                root_b = find_root(parents, candidate.b);
+            if (root_a == root_b)
+                continue;
+
+            const nav_cluster_t& cluster_a = clusters[root_a];
+            const nav_cluster_t& cluster_b = clusters[root_b];
+            nav_cluster_t merged = { std::min(cluster_a.min_x, cluster_b.min_x), std::min(cluster_a.min_y, cluster_b.min_y),
+                std::max(cluster_a.max_x, cluster_b.max_x), std::max(cluster_a.max_y, cluster_b.max_y),
+                cluster_a.area_count + cluster_b.area_count };
+
+            if (merged.area_count > NAV_COARSE_MAX_CLUSTER_AREAS || merged.max_x - merged.min_x > NAV_COARSE_MAX_CLUSTER_SIZE ||
+                merged.max_y - merged.min_y > NAV_COARSE_MAX_CLUSTER_SIZE)
+                continue;
+
+            parents[root_b] = root_a;
+            clusters[root_a] = merged;
+        }
+
+        // dense node indices in order of the first area of each node
+        m_area_nodes.assign(area_count, NAV_INVALID_INDEX);
+        std::vector< std::uint32_t > root_nodes(area_count, NAV_INVALID_INDEX);
+        std::uint32_t node_count = 0;
+
+        for (std::size_t i = 0; i < area_count; i++) {
+            std::uint32_t root = find_root(parents, static_cast<std::uint32_t>(i));
+            if (root_nodes[root] == NAV_INVALID_INDEX)
+                root_nodes[root] = node_count++;
+
+            m_area_nodes[i] = root_nodes[root];
+        }
+
+        m_node_area_start.assign(node_count + 1, 0);
+        for (std::uint32_t node : m_area_nodes)
+            m_node_area_start[node + 1]++;
+
+        for (std::size_t i = 1; i < m_node_area_start.size(); i++)
+            m_node_area_start[i] += m_node_area_start[i - 1];
+
+        m_node_areas.resize(area_count);
+        m_node_centers.assign(node_count, { });
+        std::vector< std::uint32_t > fill(m_node_area_start.begin(), m_node_area_start.end() - 1);
+
+        for (std::size_t i = 0; i < area_count; i++) {
+            std::uint32_t node = m_area_nodes[i];
+            m_node_areas[fill[node]++] = static_cast<std::uint32_t>(i);
+            m_node_centers[node] = m_node_centers[node] + nav.m_area_centers[i];
+        }
+
+        for (std::uint32_t node = 0; node < node_count; node++)
+            m_node_centers[node] = m_node_centers[node] * (1.f / static_cast<float>(m_node_area_start[node + 1] - m_node_area_start[node]));
+
+        // node edges from the area connections leaving each node, without duplicates. an edge is a ladder edge
+        // only if no walking connection makes it too
+        m_edge_start.assign(node_count + 1, 0);
+        m_edges.clear();
+        m_edge_ladder.clear();
+
+        std::vector< std::pair< std::uint32_t, std::uint8_t > > node_edges;
+        std::size_t connection_count = 0;
+        for (std::uint32_t node = 0; node < node_count; node++) {
+            node_edges.clear();
+
+            for (std::uint32_t j = m_node_area_start[node]; j < m_node_area_start[node + 1]; j++) {
+                std::size_t area_index = m_node_areas[j];
+                std::size_t first = nav.connections_area_start[area_index],
+                    last = first + nav.connections_area_length[area_index];
+
+                connection_count += last - first;
+                for (std::size_t i = first; i < last; i++) {
+                    std::uint32_t next_node = m_area_nodes[nav.connections[i]];
+                    if (next_node != node)
+                        node_edges.push_back({ next_node, nav.connections_kind[i] != nav_connection_kind::walk });
+                }
+            }
+
+            std::sort(node_edges.begin(), node_edges.end());
+            for (std::size_t i = 0; i < node_edges.size(); i++) {
+                if (i > 0 && node_edges[i].first == node_edges[i - 1].first)
+                    continue;
+
+                m_edges.push_back(node_edges[i].first);
+                m_edge_ladder.push_back(node_edges[i].second);
+            }
+
+            m_edge_start[node + 1] = static_cast<std::uint32_t>(m_edges.size());
+        }
+
+        m_stats = { area_count, connection_count, node_count, m_edges.size() };
+    }
+
+    bool nav_coarse_graph::find_corridor(std::size_t start, std::size_t goal, std::vector< std::uint64_t >& allowed_nodes,
+        bool use_ladders) const {
+        // separate from the per thread context of the area searches, which runs right after this
+        thread_local nav_search_context context;
+
+        std::size_t node_count = m_node_centers.size();
+        std::uint32_t start_node = m_area_nodes[start],
+            goal_node = m_area_nodes[goal];
+
+        allowed_nodes.assign((node_count + 63) / 64, 0);
+
+        context.begin(node_count);
+        context.reach(start_node, 0.f, start_node);
+        context.push(nav_distance(m_node_centers[start_node], m_node_centers[goal_node]), start_node);
+
+        bool found = false;
+        while (context.has_open()) {
+            std::uint32_t node = context.pop().index;
+            if (context.is_closed(node))
+                continue;
+
+            if (node == goal_node) {
+                found = true;
+                break;
+            }
+
+            context.close(node);
+
+            float node_cost = context.get_cost(node);
+            for (std::uint32_t i = m_edge_start[node]; i < m_edge_start[node + 1]; i++) {
+                std::uint32_t next_node = m_edges[i];
+                if (context.is_closed(next_node) || (m_edge_ladder[i] && !use_ladders))
+                    continue;
+
+                float next_cost = node_cost + nav_distance(m_node_centers[node], m_node_centers[next_node]);
+                if (next_cost < context.get_cost(next_node)) {
+                    context.reach(next_node, next_cost, node);
+                    context.push(next_cost + nav_distance(m_node_centers[next_node], m_node_centers[goal_node]), next_node);
+                }
+            }
+        }
+
+        if (!found)
+            return false;
+
+        for (std::uint32_t node = goal_node; ; node = context.get_parent(node)) {
+            allowed_nodes[node >> 6] |= std::uint64_t(1) << (node & 63);
+            if (node == start_node)
+                break;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "nav_query.h"
+#include <cstdint>
+#include <vector>
+
+namespace nav_mesh {
+    class nav_file;
+
+    // areas at most this long along both axes count as small, only they start or join clusters
+    constexpr float NAV_COARSE_SMALL_AREA_SIZE = 64.f;
+    // clusters stop growing at this many areas or this extent along either axis
+    constexpr std::size_t NAV_COARSE_MAX_CLUSTER_AREAS = 16;
+    constexpr float NAV_COARSE_MAX_CLUSTER_SIZE = 256.f;
+
+    struct nav_coarse_stats_t {
+        std::size_t area_count = 0,
+            connection_count = 0,
+            node_count = 0,
+            edge_count = 0;
+    };
+
+    /*
+     *	Areas merged into super nodes for guiding searches. Small areas joined both ways to a
+     *	neighbour with the same attributes and place (and without NAV_MESH_NO_MERGE) are merged
+     *	greedily, smallest pairs first, so generator fragments collapse into chains and blobs while
+     *	large areas stay nodes of their own. A search first finds the node path and then runs the
+     *	real search restricted to the areas of those nodes, see nav_path_options_t::use_coarse_graph.
+     *	Every node maps back to its areas, so the result is always a path over the original areas.
+     */
+    class nav_coarse_graph {
+    public:
+        void build(const nav_file& nav);
+        bool is_built() const { return !m_area_nodes.empty(); }
+
+        std::uint32_t get_node(std::size_t area_index) const { return m_area_nodes[area_index]; }
+        const std::uint32_t* get_area_nodes() const { return m_area_nodes.data(); }
+        // areas of a node, indexed like m_areas
+        const std::uint32_t* get_node_areas(std::size_t node, std::size_t& count) const {
+            count = m_node_area_start[node + 1] - m_node_area_start[node];
+            return m_node_areas.data() + m_node_area_start[node];
+        }
+        const nav_coarse_stats_t& get_stats() const { return m_stats; }
+
+        // A* over the nodes from the node of start to the node of goal, by distance between node centers. sets the
+        // bit of every node on the way in allowed_nodes, returns false if the nodes aren't connected. edges only a
+        // ladder connection makes are taken with use_ladders only
+        bool find_corridor(std::size_t start, std::size_t goal, std::vector< std::uint64_t >& allowed_nodes, bool use_ladders = false) const;
+
+    private:
+        std::vector< std::uint32_t > m_area_nodes = { };
+        std::vector< vec3_t > m_node_centers = { };
+
+        // areas of node i are m_node_areas[m_node_area_start[i], m_node_area_start[i + 1])
+        std::vector< std::uint32_t > m_node_area_start = { },
+            m_node_areas = { };
+
+        // nodes connected from node i are m_edges[m_edge_start[i], m_edge_start[i + 1]). m_edge_ladder is set for
+        // the edges with no walking connection behind them
+        std::vector< std::uint32_t > m_edge_start = { },
+            m_edges = { };
+        std::vector< std::uint8_t > m_edge_ladder = { };
+
+        nav_coarse_stats_t m_stats = { };
+    };
+}
@@ -0,0 +1,212 @@
+#include "nav_components.h"
+#include "nav_file.h"
+#include <algorithm>
+#include <numeric>
+
+namespace nav_mesh {
+    void nav_components::build(const nav_file& nav) {
+        std::size_t area_count = nav.m_areas.size();
+
+        m_order.assign(area_count, 0);
+        m_low.assign(area_count, 0);
+        m_found.assign(area_count, 0);
+        m_roots.assign(area_count, 0);
+        m_on_stack.assign(area_count, 0);
+
+        m_members.resize(area_count);
+        std::iota(m_members.begin(), m_members.end(), 0);
+
+        m_strong_count = run_tarjan(nav, false, 0);
+        m_strong.assign(m_found.begin(), m_found.end());
+
+        std::iota(m_roots.begin(), m_roots.end(), 0);
+        for (std::size_t area_index = 0; area_index < area_count; area_index++) {
+            std::size_t first = nav.connections_area_start[area_index],
+                last = first + nav.connections_area_length[area_index];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::uint32_t a = find_root(static_cast<std::uint32_t>(area_index)),
+                    b = find_root(static_cast<std::uint32_t>(nav.connections[i]));
+
+                if (a != b)
+                    m_roots[std::max(a, b)] = std::min(a, b);
+            }
+        }
+
+        // roots always have the lowest index of their set, so labels come out dense in one pass
+        m_weak.assign(area_count, 0);
+        m_weak_count = 0;
+        for (std::size_t area_index = 0; area_index < area_count; area_index++) {
+            std::uint32_t root = find_root(static_cast<std::uint32_t>(area_index));
+            m_weak[area_index] = root == area_index ? m_weak_count++ : m_weak[root];
+        }
+    }
+
+    void nav_components::update_after_removal(const nav_file& nav, const std::vector< std::pair< std::size_t, std::size_t > >& removed_edges) {
+        std::vector< std::uint32_t > strong_labels, weak_labels;
+
+        for (const auto& [source, target] : removed_edges) {
+            // a connection between two strong components leaves the partition and the order intact
+            if (m_strong[source] == m_strong[target])
+                strong_labels.push_back(m_strong[source]);
+
+            if (m_weak[source] == m_weak[target])
+                weak_labels.push_back(m_weak[source]);
+        }
+
+        // splitting shifts every higher label up, so go from the highest down to keep the rest valid
+        std::sort(strong_labels.begin(), strong_labels.end(), std::greater< std::uint32_t >());
+        strong_labels.erase(std::unique(strong_labels.begin(), strong_labels.end()), strong_labels.end());
+        for (std::uint32_t label : strong_labels)
+            split_strong(nav, label);
+
+        std::sort(weak_labels.begin(), weak_labels.end());
+        weak_labels.erase(std::unique(weak_labels.begin(), weak_labels.end()), weak_labels.end());
+        for (std::uint32_t label : weak_labels)
+            split_weak(nav, label);
+    }
+
+    void nav_components::update_after_addition(const nav_file& nav, const std::vector< std::pair< std::size_t, std::size_t > >& added_edges) {
+        for (const auto& [source, target] : added_edges) {
+            // going down the reverse topological order inside one weak component can't close a cycle
+            if (m_weak[source] != m_weak[target] || m_strong[source] < m_strong[target]) {
+                build(nav);
+                return;
+            }
+        }
+    }
+
+    std::uint32_t nav_components::run_tarjan(const nav_file& nav, bool restricted, std::uint32_t restrict_to) {
+        std::uint32_t next_order = 1,
+            component_count = 0;
+
+        for (std::uint32_t area_index : m_members)
+            m_order[area_index] = 0;
+
+        for (std::uint32_t root : m_members) {
+            if (m_order[root] != 0)
+                continue;
+
+            m_order[root] = m_low[root] = next_order++;
+            m_stack.push_back(root);
+            m_on_stack[root] = 1;
+            m_frames.push_back({ root, nav.connections_area_start[root] });
+
+            while (!m_frames.empty()) {
+                std::uint32_t area_index = m_frames.back().area_index;
+                std::size_t last = nav.connections_area_start[area_index] + nav.connections_area_length[area_index];
+
+                if (m_frames.back().next_connection < last) {
+                    auto next_index = static_cast<std::uint32_t>(nav.connections[m_frames.back().next_connection++]);
+                    if (restricted && m_strong[next_index] != restrict_to)
+                        continue;
+
+                    if (m_order[next_index] == 0) {
+                        m_order[next_index] = m_low[next_index] = next_order++;
+                        m_stack.push_back(next_index);
+                        m_on_stack[next_index] = 1;
+                        m_frames.push_back({ next_index, nav.connections_area_start[next_index] });
+                    }
+                    else if (m_on_stack[next_index]) {
+                        m_low[area_index] = std::min(m_low[area_index], m_order[next_index]);
+                    }
+
+                    continue;
+                }
+
+                m_frames.pop_back();
+                if (!m_frames.empty()) {
+                    std::uint32_t parent = m_frames.back().area_index;
+                    m_low[parent] = std::min(m_low[parent], m_low[area_index]);
+                }
+
+                if (m_low[area_index] != m_order[area_index])
+                    continue;
+
+                std::uint32_t member;
+                do {
+                    member = m_stack.back();
+                    m_stack.pop_back();
+                    m_on_stack[member] = 0;
+                    m_found[member] = component_count;
+                } while (member != area_index);
+
+                component_count++;
+            }
+        }
+
+        return component_count;
+    }
+
+    void nav_components::split_strong(const nav_file& nav, std::uint32_t label) {
+        m_members.clear();
+        for (std::size_t area_index = 0; area_index < m_strong.size(); area_index++) {
+            if (m_strong[area_index] == label)
+                m_members.push_back(static_cast<std::uint32_t>(area_index));
+        }
+
+        if (m_members.size() < 2)
+            return;
+
+        std::uint32_t split_count = run_tarjan(nav, true, label);
+        if (split_count < 2)
+            return;
+
+        // the pieces take over the slot of the old component, in their own reverse topological order
+        for (auto& strong : m_strong) {
+            if (strong > label)
+                strong += split_count - 1;
+        }
+
+        for (std::uint32_t area_index : m_members)
+            m_strong[area_index] = label + m_found[area_index];
+
+        m_strong_count += split_count - 1;
+    }
+
+    void nav_components::split_weak(const nav_file& nav, std::uint32_t label) {
+        m_members.clear();
+        for (std::size_t area_index = 0; area_index < m_weak.size(); area_index++) {
+            if (m_weak[area_index] == label) {
+                m_members.push_back(static_cast<std::uint32_t>(area_index));
+                m_roots[area_index] = static_cast<std::uint32_t>(area_index);
+            }
+        }
+
+        for (std::uint32_t area_index : m_members) {
+            std::size_t first = nav.connections_area_start[area_index],
+                last = first + nav.connections_area_length[area_index];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::uint32_t a = find_root(area_index),
+                    b = find_root(static_cast<std::uint32_t>(nav.connections[i]));
+
+                if (a != b)
+                    m_roots[std::max(a, b)] = std::min(a, b);
+            }
+        }
+
+        // the set holding the first member keeps the label, every other set gets a fresh one
+        std::uint32_t kept_root = find_root(m_members.front());
+        for (std::uint32_t area_index : m_members) {
+            std::uint32_t root = find_root(area_index);
+
+            if (root == kept_root)
+                continue;
+
+            if (root == area_index)
+                m_weak[area_index] = m_weak_count++;
+            else
+                m_weak[area_index] = m_weak[root];
+        }
+    }
+
+    std::uint32_t nav_components::find_root(std::uint32_t area_index) {
+        while (m_roots[area_index] != area_index) {
+            m_roots[area_index] = m_roots[m_roots[area_index]];
+            area_index = m_roots[area_index];
+        }
+
+        return area_index;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace nav_mesh {
+    class nav_file;
+
+    /*
+     *	Connected component labels over the CSR connection arrays, indexed like m_areas.
+     *
+     *	Strong components are numbered in reverse topological order (Tarjan finishes sinks first),
+     *	so a connection between two different strong components always goes from the higher label
+     *	to the lower one. Together with the weak components this gives an O(1) test that rejects
+     *	most impossible queries: islands differ in their weak label and one way drops leave the
+     *	goal with a higher strong label than the start.
+     */
+    class nav_components {
+    public:
+        void build(const nav_file& nav);
+
+        // removing connections can only split components, so only the components that lost an
+        // internal connection are relabelled. edges are (source index, target index) pairs
+        void update_after_removal(const nav_file& nav, const std::vector< std::pair< std::size_t, std::size_t > >& removed_edges);
+        // adding connections can only merge components. connections that agree with the current labels change
+        // nothing, anything else relabels everything
+        void update_after_addition(const nav_file& nav, const std::vector< std::pair< std::size_t, std::size_t > >& added_edges);
+
+        // false means goal is definitely unreachable from start, true means it may be reachable
+        bool may_reach(std::size_t start, std::size_t goal) const {
+            return m_weak[start] == m_weak[goal] && m_strong[start] >= m_strong[goal];
+        }
+
+        // true when both areas can reach each other
+        bool is_same_strong(std::size_t a, std::size_t b) const { return m_strong[a] == m_strong[b]; }
+
+        std::uint32_t get_strong(std::size_t area_index) const { return m_strong[area_index]; }
+        std::uint32_t get_weak(std::size_t area_index) const { return m_weak[area_index]; }
+
+        std::uint32_t m_strong_count = 0,
+            m_weak_count = 0;
+
+    private:
+        // labels the areas in members, following only connections that stay inside label
+        // restrict_to when restricted is set. returns the number of strong components found
+        std::uint32_t run_tarjan(const nav_file& nav, bool restricted, std::uint32_t restrict_to);
+        void split_strong(const nav_file& nav, std::uint32_t label);
+        void split_weak(const nav_file& nav, std::uint32_t label);
+
+        std::uint32_t find_root(std::uint32_t area_index);
+
+        std::vector< std::uint32_t > m_strong = { },
+            m_weak = { };
+
+        struct tarjan_frame_t {
+            std::uint32_t area_index;
+            std::size_t next_connection;
+        };
+
+        // scratch, kept around so updates don't reallocate
+        std::vector< std::uint32_t > m_members = { },
+            m_order = { },
+            m_low = { },
+            m_stack = { },
+            m_found = { },
+            m_roots = { };
+
+        std::vector< std::uint8_t > m_on_stack = { };
+        std::vector< tarjan_frame_t > m_frames = { };
+    };
+}
@@ -0,0 +1,151 @@
+#include "nav_corridor.h"
+#include "nav_file.h"
+#include "nav_search.h"
+
+namespace nav_mesh {
+    nav_path_status nav_corridor::plan(vec3_t from, vec3_t to, const nav_path_options_t& options) {
+        m_options = options;
+        m_target = to;
+        m_goal = m_nav->get_area_index(m_nav->get_nearest_area_by_position(to));
+
+        return replan(m_nav->get_area_index(m_nav->get_nearest_area_by_position(from)));
+    }
+
+    nav_corridor_update nav_corridor::update(vec3_t position) {
+        bool stale = is_stale();
+
+        if (!m_areas.empty() && !stale) {
+            std::size_t corridor_index = find_on_corridor(position);
+            if (corridor_index != NAV_INVALID_INDEX) {
+                m_first = corridor_index;
+                return nav_corridor_update::on_corridor;
+            }
+
+            if (rejoin_through_neighbour(position))
+                return nav_corridor_update::rejoined;
+        }
+
+        // the agent is off the corridor, search from the ground under it
+        std::uint32_t area_index = m_nav->m_area_grid.get_ground_area(position);
+        if (area_index == NAV_INVALID_INDEX)
+            area_index = static_cast<std::uint32_t>(m_nav->get_area_index(m_nav->get_nearest_area_by_position(position)));
+
+        if (!m_areas.empty() && !stale && rejoin_through_search(area_index))
+            return nav_corridor_update::rejoined;
+
+        return replan(area_index) == nav_path_status::no_solution ? nav_corridor_update::lost : nav_corridor_update::replanned;
+    }
+
+    bool nav_corridor::is_stale() const {
+        return m_graph_version != m_nav->m_graph_version;
+    }
+
+    void nav_corridor::get_path(std::vector< vec3_t >& path) const {
+        path.clear();
+        if (is_empty() || is_stale())
+            return;
+
+        // the corridor keeps areas only, so the connections are picked again like its search would
+        thread_local std::vector< std::uint32_t > path_connections;
+        m_nav->find_path_connections(get_areas(), get_area_count(), m_options, path_connections);
+        m_nav->build_path_points(get_areas(), get_area_count(), m_target, path, path_connections.data());
+    }
+
+    std::size_t nav_corridor::find_on_corridor(vec3_t position) const {
+        std::size_t last = std::min(m_areas.size(), m_first + NAV_CORRIDOR_LOOKAHEAD + 1);
+
+        for (std::size_t i = m_first; i < last; i++) {
+            if (m_nav->m_areas[m_areas[i]].is_within_3d(position))
+                return i;
+        }
+
+        return NAV_INVALID_INDEX;
+    }
+
+    bool nav_corridor::rejoin_through_neighbour(vec3_t position) {
+        // an area with a connection into the current or the next area of the corridor is one step from being back on,
+        // as long as the options of the plan would have allowed the search to take that connection
+        std::size_t last = std::min(m_areas.size(), m_first + 2);
+
+        std::size_t joined_index = NAV_INVALID_INDEX, source = NAV_INVALID_INDEX;
+        nav_dispatch_cost_profile(*m_nav, m_options, [&](const auto& policy) {
+            for (std::size_t k = m_first; k < last && joined_index == NAV_INVALID_INDEX; k++) {
+                std::size_t corridor_area = m_areas[k];
+                std::size_t first = m_nav->reverse_connections_area_start[corridor_area],
+                    end = first + m_nav->reverse_connections_area_length[corridor_area];
+
+                for (std::size_t i = first; i < end; i++) {
+                    std::size_t candidate = m_nav->reverse_connections[i];
+                    if (!policy.allows_connection(m_nav->reverse_connections_edge[i]) || !policy.allows(candidate) ||
+                        !m_nav->m_areas[candidate].is_within_3d(position))
+                        continue;
+
+                    joined_index = k;
+                    source = candidate;
+                    break;
+                }
+            }
+        });
+
+        if (joined_index == NAV_INVALID_INDEX)
+            return false;
+
+        if (joined_index > 0) {
+            m_first = joined_index - 1;
+            m_areas[m_first] = static_cast<std::uint32_t>(source);
+        }
+        else {
+            m_areas.insert(m_areas.begin(), static_cast<std::uint32_t>(source));
+        }
+
+        return true;
+    }
+
+    bool nav_corridor::rejoin_through_search(std::size_t area_index) {
+        std::size_t window_end = std::min(m_areas.size(), m_first + NAV_CORRIDOR_REJOIN_WINDOW);
+        nav_search_context& context = get_thread_search_context();
+
+        context.m_goals.assign(m_areas.begin() + m_first, m_areas.begin() + window_end);
+        std::sort(context.m_goals.begin(), context.m_goals.end());
+
+        std::uint32_t joined = nav_dispatch_cost_profile(*m_nav, m_options, [&](const auto& policy) {
+            return nav_search_nearest_goal(*m_nav, context, area_index, policy, NAV_CORRIDOR_REJOIN_EXPANSIONS);
+        });
+
+        if (joined == NAV_INVALID_INDEX)
+            return false;
+
+        // the way back on, then the corridor from the area after the one joined
+        context.build_path(area_index, joined);
+        std::size_t joined_index = std::find(m_areas.begin() + m_first, m_areas.begin() + window_end, joined) - m_areas.begin();
+
+        m_scratch.assign(context.m_path.begin(), context.m_path.end());
+        m_scratch.insert(m_scratch.end(), m_areas.begin() + joined_index + 1, m_areas.end());
+        m_areas.swap(m_scratch);
+        m_first = 0;
+
+        return true;
+    }
+
+    nav_path_status nav_corridor::replan(std::size_t area_index) {
+        m_areas.clear();
+        m_first = 0;
+        m_graph_version = m_nav->m_graph_version;
+
+        if (area_index == m_goal) {
+            m_areas.push_back(static_cast<std::uint32_t>(area_index));
+            return nav_path_status::start_end_same;
+        }
+
+        if (!m_nav->m_components.may_reach(area_index, m_goal))
+            return nav_path_status::no_solution;
+
+        // a partial plan still leads towards the target, the next replan continues from wherever the agent got
+        nav_search_context& context = get_thread_search_context();
+        nav_path_status status = m_nav->solve_path(context, area_index, m_goal, m_options);
+        if (status != nav_path_status::no_solution)
+            m_areas.assign(context.m_path.begin(), context.m_path.end());
+
+        return status;
+    }
+}
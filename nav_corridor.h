@@ -0,0 +1,73 @@
+#pragma once
+#include "nav_query.h"
+#include <cstdint>
+#include <vector>
+
+namespace nav_mesh {
+    class nav_file;
+
+    enum class nav_corridor_update : std::uint8_t {
+        // the agent is on the current area or one of the next few, anything behind it got trimmed
+        on_corridor,
+        // the agent left the corridor and a short local search led it back on
+        rejoined,
+        // nothing close was found, the corridor was planned again from the agent to the target
+        replanned,
+        // the target can't be reached from where the agent is, the corridor is empty
+        lost
+    };
+
+    // areas ahead of the current one an agent may have skipped to between updates
+    constexpr std::size_t NAV_CORRIDOR_LOOKAHEAD = 8;
+    // areas ahead of the current one a local replan may join back onto
+    constexpr std::size_t NAV_CORRIDOR_REJOIN_WINDOW = 32;
+    // budget of the local replan before giving up on it and planning from scratch
+    constexpr std::uint32_t NAV_CORRIDOR_REJOIN_EXPANSIONS = 256;
+
+    /*
+     *	The area sequence of a plan, kept per agent and updated as the agent moves. An agent that
+     *	stays on its plan only costs a few bounds checks per update, one pushed aside is led back
+     *	through a neighbour or a small local search, and only an agent that strayed far off gets a
+     *	full replan. Searches run on the search context of the calling thread.
+     */
+    class nav_corridor {
+    public:
+        nav_corridor(const nav_file& nav) : m_nav(&nav) { }
+
+        nav_path_status plan(vec3_t from, vec3_t to, const nav_path_options_t& options = { });
+        // re-anchors the corridor on the agent at position, replanning from it once the connections of the mesh changed
+        nav_corridor_update update(vec3_t position);
+
+        bool is_empty() const { return m_first == m_areas.size(); }
+        // the connections changed since the plan was made, it may cross edges that are gone until the next update
+        bool is_stale() const;
+        // remaining areas, the one the agent is on first and the goal area last
+        const std::uint32_t* get_areas() const { return m_areas.data() + m_first; }
+        std::size_t get_area_count() const { return m_areas.size() - m_first; }
+        vec3_t get_target() const { return m_target; }
+
+        // remaining path as area centers and shared edge middles like nav_file::find_path, path is cleared first.
+        // a stale corridor leaves it empty
+        void get_path(std::vector< vec3_t >& path) const;
+
+    private:
+        // corridor index of the area holding position within the lookahead, NAV_INVALID_INDEX if there is none
+        std::size_t find_on_corridor(vec3_t position) const;
+        bool rejoin_through_neighbour(vec3_t position);
+        bool rejoin_through_search(std::size_t area_index);
+        nav_path_status replan(std::size_t area_index);
+
+        const nav_file* m_nav = nullptr;
+        // an overlay in here must outlive the corridor
+        nav_path_options_t m_options = { };
+        vec3_t m_target = { };
+        std::size_t m_goal = 0;
+        // nav_file::m_graph_version when the plan was made
+        std::uint64_t m_graph_version = 0;
+
+        // the plan, of which m_areas[m_first, end) is still ahead
+        std::vector< std::uint32_t > m_areas = { };
+        std::size_t m_first = 0;
+        std::vector< std::uint32_t > m_scratch = { };
+    };
+}
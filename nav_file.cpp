@@ -1,25 +1,45 @@
 #include "nav_file.h"
+#include "nav_search.h"
 #include <iostream>
 #include <memory>
 #include <limits>
 #include <cmath>
 #include <csignal>
-#define PLAYER_WIDTH 32
+#include <fstream>
+#include <numeric>
+#include <unordered_map>
+#include <tuple>
 
 namespace nav_mesh {
-    nav_file::nav_file(std::string_view nav_mesh_file) {
+    nav_file::nav_file(std::string_view nav_mesh_file, nav_area_order order) {
 
-        load(nav_mesh_file);
+        load(nav_mesh_file, order);
     }
 
-    void nav_file::load(std::string_view nav_mesh_file) {
+    void nav_file::load(std::string_view nav_mesh_file, nav_area_order order) {
+        // replacing the pool and the warm up cancels and waits for everything still out against the old mesh
+        m_path_workers = std::make_unique< nav_path_workers >(*this);
+        m_path_cache_warm_up = std::make_unique< nav_path_cache_warm_up >();
+
         if (!m_pather)
             m_pather = std::make_unique< micropather::MicroPather >(this);
 
+        if (!m_path_cache)
+            m_path_cache = std::make_unique< nav_path_cache >();
+
         m_pather->Reset();
+        m_path_cache->clear();
+        m_graph_version++;
+        m_loaded_graph_version = m_graph_version;
         m_areas.clear();
         m_places.clear();
+        m_ladders.clear();
         m_area_ids_to_indices.clear();
+        m_area_ptr_ids_to_indices.clear();
+        m_area_centers.clear();
+        m_area_attributes.clear();
+        // indexed like the old areas, build_coarse_graph has to be called again
+        m_coarse_graph = { };
 
         m_buffer.load_from_file(nav_mesh_file);
 
@@ -56,15 +76,120 @@ namespace nav_mesh {
             m_areas.push_back(area);
         }
 
+        // files saved without any ladders may end right after the areas
+        if (m_buffer.get_remaining() >= sizeof(std::uint32_t)) {
+            auto ladder_count = m_buffer.read< std::uint32_t >();
+
+            for (std::uint32_t i = 0; i < ladder_count; i++) {
+                if (m_buffer.get_remaining() < 2 * sizeof(vec3_t) + 9 * sizeof(std::uint32_t))
+                    throw std::runtime_error("nav_file::load: truncated ladders");
+
+                nav_ladder_t ladder;
+                ladder.id = m_buffer.read< std::uint32_t >();
+                ladder.width = m_buffer.read< float >();
+                m_buffer.read(&ladder.top, sizeof(vec3_t));
+                m_buffer.read(&ladder.bottom, sizeof(vec3_t));
+                ladder.length = m_buffer.read< float >();
+                ladder.direction = m_buffer.read< std::uint32_t >();
+                ladder.top_forward_area = m_buffer.read< std::uint32_t >();
+                ladder.top_left_area = m_buffer.read< std::uint32_t >();
+                ladder.top_right_area = m_buffer.read< std::uint32_t >();
+                ladder.top_behind_area = m_buffer.read< std::uint32_t >();
+                ladder.bottom_area = m_buffer.read< std::uint32_t >();
+                m_ladders.push_back(ladder);
+            }
+        }
+
+        m_map_hash = m_buffer.get_hash();
         m_buffer.clear();
 
+        reorder_areas(order);
+
         for (size_t area_id = 0; area_id < m_areas.size(); area_id++) {
             m_area_ids_to_indices.insert({ m_areas[area_id].get_id(), area_id });
             // navfile.h AdjacentCost does same cast to work with micropather, so as long I do same cast, should be fine?
             m_area_ptr_ids_to_indices.insert({ reinterpret_cast<void*>(m_areas[area_id].get_id()), area_id });
+            m_area_centers.push_back(m_areas[area_id].get_center());
+            m_area_attributes.push_back(m_areas[area_id].m_attribute_flags);
         }
 
         build_connections_arrays();
+        m_components.build(*this);
+        m_area_grid.build(*this);
+
+        // the bitset rows replace the per area lists, which would only cost memory from here on
+        m_visibility.build(*this);
+        for (auto& area : m_areas)
+            area.m_potentially_visible_areas = { };
+
+        m_tactical.build(*this);
+    }
+
+    namespace {
+        // position of x, y along a Hilbert curve filling a 65536 x 65536 grid
+        std::uint64_t get_hilbert_index(std::uint32_t x, std::uint32_t y) {
+            constexpr std::uint32_t n = 1 << 16;
+            std::uint64_t d = 0;
+
+            for (std::uint32_t s = n / 2; s > 0; s /= 2) {
+                std::uint32_t rx = (x & s) != 0,
+                    ry = (y & s) != 0;
+
+                d += static_cast<std::uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+                // rotate the quadrant so the curve stays continuous
+                if (ry == 0) {
+                    if (rx == 1) {
+                        x = n - 1 - x;
+                        y = n - 1 - y;
+                    }
+                    std::swap(x, y);
+                }
+            }
+
+            return d;
+        }
+
+        // everything besides the overlay contents that decides which path a search returns
+        std::uint64_t get_path_cache_tag(const nav_path_options_t& options) {
+            std::uint64_t h = 14695981039346656037ULL;
+            auto mix = [&](std::uint64_t value) {
+                h ^= value;
+                h *= 1099511628211ULL;
+            };
+            auto mix_float = [&](float value) {
+                std::uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                mix(bits);
+            };
+
+            mix(static_cast<std::uint64_t>(options.profile));
+            if (options.profile == nav_cost_profile::attribute_weighted) {
+                for (const auto& weight : options.attribute_weights) {
+                    mix(weight.attributes);
+                    mix_float(weight.scale);
+                }
+            }
+            else if (options.profile == nav_cost_profile::time) {
+                mix_float(options.run_speed);
+                mix_float(options.walk_speed);
+                mix_float(options.crouch_speed);
+            }
+
+            // weighted and coarse searches may settle for another path
+            mix_float(options.heuristic_weight);
+            mix(options.use_coarse_graph);
+            mix_float(options.min_width);
+            mix(options.use_ladders);
+
+            if (options.overlay) {
+                mix(options.overlay->m_forbidden_attributes);
+                mix(options.overlay->m_avoided_attributes);
+                mix_float(options.overlay->m_avoid_penalty);
+            }
+
+            return h;
+        }
     }
 
     std::optional< std::vector< vec3_t > > nav_file::find_path(vec3_t from, vec3_t to) {
@@ -76,47 +201,22 @@ namespace nav_mesh {
             return path;
         }
 
-        float total_cost = 0.f;
-        micropather::MPVector< void* > path_area_ids = { };
-
-        if (m_pather->Solve(start, end, &path_area_ids, &total_cost) != 0) {
+        if (!m_components.may_reach(m_area_ptr_ids_to_indices[start], m_area_ptr_ids_to_indices[end])) {
             return {};
         }
 
-        for (std::size_t i = 0; i < path_area_ids.size(); i++) {
-            nav_area& area = m_areas[m_area_ptr_ids_to_indices[path_area_ids[i]]];
-            // smooth paths by adding intersections between nav areas after the first 
-            // chose area in between nearest location in area i from center of i-1
-            // and nearest location in area i-1 from center of i
-            // as this will have max distance on either side for player to fit through
-            if (i != 0) {
-                nav_area& last_area = m_areas[m_area_ptr_ids_to_indices[path_area_ids[i - 1]]];
-                // nw is min values, se is max value, so checking if x or y is the meeting point
-                bool last_area_x_lesser = area.m_nw_corner.x == last_area.m_se_corner.x;
-                bool area_x_lesser = area.m_se_corner.x == last_area.m_nw_corner.x;
-                bool last_area_y_lesser = area.m_nw_corner.y == last_area.m_se_corner.y;
-                bool x_lesser = last_area_x_lesser || area_x_lesser;
-                vec3_t middle;
-                if (x_lesser) {
-                    middle.x = last_area_x_lesser ? area.m_nw_corner.x : last_area.m_nw_corner.x;
-                    float max_valid_y = std::min(area.m_se_corner.y, last_area.m_se_corner.y);
-                    float min_valid_y = std::min(area.m_nw_corner.y, last_area.m_nw_corner.y);
-                    middle.y = (max_valid_y + min_valid_y) / 2.f;
-                }
-                else {
-                    middle.y = last_area_y_lesser ? area.m_nw_corner.y : last_area.m_nw_corner.y;
-                    float max_valid_x = std::min(area.m_se_corner.x, last_area.m_se_corner.x);
-                    float min_valid_x = std::min(area.m_nw_corner.x, last_area.m_nw_corner.x);
-                    middle.x = (max_valid_x + min_valid_x) / 2.f;
+        float total_cost = 0.f;
+        m_path_area_ids.clear();
 
-                }
-                middle.z = (area.get_center().z + last_area.get_center().z) / 2.f;
-                path.push_back(middle);
-            }
-            path.push_back(area.get_center());
+        if (m_pather->Solve(start, end, &m_path_area_ids, &total_cost) != 0) {
+            return {};
         }
 
-        path.push_back(to);
+        m_path_area_indices.resize(m_path_area_ids.size());
+        for (std::size_t i = 0; i < m_path_area_ids.size(); i++)
+            m_path_area_indices[i] = static_cast<std::uint32_t>(m_area_ptr_ids_to_indices[m_path_area_ids[i]]);
+
+        build_path_points(m_path_area_indices.data(), m_path_area_indices.size(), to, path);
 
         return path;
     }
@@ -132,73 +232,776 @@ namespace nav_mesh {
             return path;
         }
 
+        if (!m_components.may_reach(get_area_index(fromArea), get_area_index(toArea))) {
+            return {};
+        }
+
         float total_cost = 0.f;
-        micropather::MPVector< void* > path_area_ids = { };
+        m_path_area_ids.clear();
+
+        if (m_pather->Solve(start, end, &m_path_area_ids, &total_cost) != 0) {
+            return {};
+        }
+
+        m_path_area_indices.resize(m_path_area_ids.size());
+        for (std::size_t i = 0; i < m_path_area_ids.size(); i++)
+            m_path_area_indices[i] = static_cast<std::uint32_t>(m_area_ptr_ids_to_indices[m_path_area_ids[i]]);
+
+        build_path_nodes(m_path_area_indices.data(), m_path_area_indices.size(), to, path);
+
+        return path;
+    }
 
-        if (m_pather->Solve(start, end, &path_area_ids, &total_cost) != 0) {
+    std::optional< std::vector< vec3_t > > nav_file::find_path(vec3_t from, vec3_t to, const nav_path_options_t& options) const {
+        std::vector< vec3_t > path = { };
+        if (find_path(from, to, path, options) == nav_path_status::no_solution) {
             return {};
         }
 
-        for (std::size_t i = 0; i < path_area_ids.size(); i++) {
-            nav_area& area = m_areas[m_area_ptr_ids_to_indices[path_area_ids[i]]];
-            // smooth paths by adding intersections between nav areas after the first
-            // chose area in between nearest location in area i from center of i-1
-            // and nearest location in area i-1 from center of i
-            // as this will have max distance on either side for player to fit through
-            if (i != 0) {
-                nav_area& last_area = m_areas[m_area_ptr_ids_to_indices[path_area_ids[i - 1]]];
-                // nw is min values, se is max value, so checking if x or y is the meeting point
-                bool last_area_x_lesser = last_area.get_max_corner().x <= area.get_min_corner().x;
-                bool area_x_lesser = area.get_max_corner().x <= last_area.get_min_corner().x;
-                bool last_area_y_lesser = last_area.get_max_corner().y <= area.get_min_corner().y;
-                bool area_y_lesser = area.get_max_corner().y <= last_area.get_min_corner().y;
-                if (!last_area_x_lesser && !area_x_lesser && !last_area_y_lesser && !area_y_lesser) {
-                    // edges of cat cause overhang, causing overlapping areas in x and y. doens't seem to be a problem
-                    // so ignore it for now
-                    // std::cout << "bad path from area " << last_area.get_id() << " to " << area.get_id() << std::endl;
+        return path;
+    }
+
+    std::optional< std::vector< PathNode > > nav_file::find_path_detailed(vec3_t from, vec3_t to, const nav_path_options_t& options) const {
+        std::vector< PathNode > path = { };
+        if (find_path_detailed(from, to, path, options) == nav_path_status::no_solution) {
+            return {};
+        }
+
+        return path;
+    }
+
+    nav_path_status nav_file::find_path(vec3_t from, vec3_t to, std::vector< vec3_t >& path, const nav_path_options_t& options,
+        nav_path_stats_t* stats) const {
+        std::size_t start = get_area_index(get_nearest_area_by_position(from));
+        std::size_t goal = get_area_index(get_nearest_area_by_position(to));
+        path.clear();
+        if (stats) {
+            *stats = { };
+        }
+
+        if (start == goal) {
+            path.push_back(to);
+            if (stats) {
+                stats->cost = 0.f;
+            }
+            return nav_path_status::start_end_same;
+        }
+
+        if (!m_components.may_reach(start, goal)) {
+            return nav_path_status::no_solution;
+        }
+
+        nav_search_context& context = get_thread_search_context();
+        nav_path_status status = solve_path(context, start, goal, options, stats);
+        if (status != nav_path_status::no_solution) {
+            build_path_output(context, status, from, to, options, path);
+        }
+
+        return status;
+    }
+
+    nav_path_status nav_file::find_path_detailed(vec3_t from, vec3_t to, std::vector< PathNode >& path, const nav_path_options_t& options,
+        nav_path_stats_t* stats) const {
+        std::size_t start = get_area_index(get_nearest_area_by_position(from));
+        std::size_t goal = get_area_index(get_nearest_area_by_position(to));
+        path.clear();
+        if (stats) {
+            *stats = { };
+        }
+
+        if (start == goal) {
+            path.push_back({ false, m_areas[goal].get_id(), 0, to });
+            if (stats) {
+                stats->cost = 0.f;
+            }
+            return nav_path_status::start_end_same;
+        }
+
+        if (!m_components.may_reach(start, goal)) {
+            return nav_path_status::no_solution;
+        }
+
+        nav_search_context& context = get_thread_search_context();
+        nav_path_status status = solve_path(context, start, goal, options, stats);
+        if (status != nav_path_status::no_solution) {
+            build_path_output(context, status, from, to, options, path);
+        }
+
+        return status;
+    }
+
+    nav_path_status nav_file::begin_path_search(vec3_t from, vec3_t to, nav_search_handle& handle, const nav_path_options_t& options) const {
+        handle.m_options = options;
+        handle.m_from = from;
+        handle.m_to = to;
+        handle.m_start = get_area_index(get_nearest_area_by_position(from));
+        handle.m_goal = get_area_index(get_nearest_area_by_position(to));
+
+        if (handle.m_start == handle.m_goal) {
+            return handle.m_status = nav_path_status::start_end_same;
+        }
+
+        if (!m_components.may_reach(handle.m_start, handle.m_goal)) {
+            return handle.m_status = nav_path_status::no_solution;
+        }
+
+        float cost = 0.f;
+        if (options.use_path_cache && m_path_cache &&
+            m_path_cache->find(get_path_cache_key(handle.m_start, handle.m_goal, options), handle.m_context.m_path, cost)) {
+            nav_search_context& context = handle.m_context;
+            find_path_connections(context.m_path.data(), context.m_path.size(), options, context.m_path_connections);
+            return handle.m_status = handle.m_context.m_path.empty() ? nav_path_status::no_solution : nav_path_status::solved;
+        }
+
+        nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            nav_search_astar_begin(*this, handle.m_context, handle.m_start, handle.m_goal, policy, options.heuristic_weight);
+        });
+
+        return handle.m_status = nav_path_status::partial;
+    }
+
+    nav_path_status nav_file::resume_path_search(nav_search_handle& handle, std::vector< vec3_t >& path) const {
+        path.clear();
+        if (handle.m_status == nav_path_status::start_end_same) {
+            path.push_back(handle.m_to);
+        }
+        else if (handle.m_status != nav_path_status::no_solution) {
+            continue_path_search(handle);
+            if (handle.m_status != nav_path_status::no_solution)
+                build_path_output(handle.m_context, handle.m_status, handle.m_from, handle.m_to, handle.m_options, path);
+        }
+
+        return handle.m_status;
+    }
+
+    nav_path_status nav_file::resume_path_search(nav_search_handle& handle, std::vector< PathNode >& path) const {
+        path.clear();
+        if (handle.m_status == nav_path_status::start_end_same) {
+            path.push_back({ false, m_areas[handle.m_goal].get_id(), 0, handle.m_to });
+        }
+        else if (handle.m_status != nav_path_status::no_solution) {
+            continue_path_search(handle);
+            if (handle.m_status != nav_path_status::no_solution)
+                build_path_output(handle.m_context, handle.m_status, handle.m_from, handle.m_to, handle.m_options, path);
+        }
+
+        return handle.m_status;
+    }
+
+    void nav_file::continue_path_search(nav_search_handle& handle) const {
+        if (handle.m_status != nav_path_status::partial)
+            return;
+
+        nav_search_context& context = handle.m_context;
+        const nav_path_options_t& options = handle.m_options;
+        handle.m_status = nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            return nav_search_astar_resume(*this, context, handle.m_goal, policy, options.max_expansions, options.deadline,
+                options.cancelled);
+        });
+
+        if (handle.m_status == nav_path_status::partial) {
+            context.build_path(handle.m_start, context.m_best);
+            return;
+        }
+
+        if (handle.m_status == nav_path_status::solved)
+            context.build_path(handle.m_start, handle.m_goal);
+        else
+            context.m_path.clear();
+
+        if (options.use_path_cache && m_path_cache) {
+            m_path_cache->insert(get_path_cache_key(handle.m_start, handle.m_goal, options), context.m_path.data(), context.m_path.size(),
+                handle.m_status == nav_path_status::solved ? context.get_cost(handle.m_goal) : FLT_MAX);
+        }
+    }
+
+    nav_path_request nav_file::find_path_async(vec3_t from, vec3_t to, const nav_path_options_t& options,
+        nav_request_priority priority, nav_path_callback callback) const {
+        if (!m_path_workers)
+            throw std::runtime_error("nav_file::find_path_async: nothing loaded");
+
+        return m_path_workers->request_path(from, to, options, priority, std::move(callback));
+    }
+
+    std::optional< float > nav_file::path_cost(vec3_t from, vec3_t to, const nav_path_options_t& options, float* length) const {
+        std::size_t start = get_area_index(get_nearest_area_by_position(from));
+        std::size_t goal = get_area_index(get_nearest_area_by_position(to));
+        if (start == goal) {
+            if (length) {
+                *length = nav_distance(from, to);
+            }
+            return 0.f;
+        }
+
+        if (!m_components.may_reach(start, goal)) {
+            return {};
+        }
+
+        nav_search_context& context = get_thread_search_context();
+        bool found = nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            return nav_search_astar(*this, context, start, goal, policy, false, options.heuristic_weight);
+        });
+
+        if (!found) {
+            return {};
+        }
+
+        if (length) {
+            *length = get_portal_path_length(context, start, goal, from, to);
+        }
+
+        return context.get_cost(goal);
+    }
+
+    void nav_file::path_costs(vec3_t from, const std::vector< vec3_t >& to, std::vector< float >& costs, const nav_path_options_t& options) const {
+        std::size_t start = get_area_index(get_nearest_area_by_position(from));
+        nav_search_context& context = get_thread_search_context();
+
+        // goals[i] belongs to to[i], the ones that can't be reached are left out of the search
+        std::vector< std::uint32_t >& goals = context.m_goals;
+        goals.resize(to.size());
+        for (std::size_t i = 0; i < to.size(); i++) {
+            std::size_t goal = get_area_index(get_nearest_area_by_position(to[i]));
+            goals[i] = m_components.may_reach(start, goal) ? static_cast<std::uint32_t>(goal) : NAV_INVALID_INDEX;
+        }
+
+        nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            nav_search_costs(*this, context, start, policy);
+        });
+
+        costs.resize(to.size());
+        for (std::size_t i = 0; i < to.size(); i++)
+            costs[i] = goals[i] != NAV_INVALID_INDEX && context.is_closed(goals[i]) ? context.get_cost(goals[i]) : FLT_MAX;
+    }
+
+    std::size_t nav_file::areas_within_cost(vec3_t from, float max_cost, std::vector< nav_area_cost_t >& areas,
+        const nav_path_options_t& options) const {
+        std::size_t start = get_area_index(get_nearest_area_by_position(from));
+
+        areas.clear();
+        nav_search_context& context = get_thread_search_context();
+        nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            nav_search_within_cost(*this, context, start, max_cost, policy, areas);
+        });
+
+        return areas.size();
+    }
+
+    void nav_file::build_flow_field(const std::vector< std::uint32_t >& goal_area_ids, nav_flow_field& field,
+        const nav_path_options_t& options, float max_cost) const {
+        field.m_goals.clear();
+        for (std::uint32_t goal_area_id : goal_area_ids)
+            field.m_goals.push_back(static_cast<std::uint32_t>(get_area_index(goal_area_id)));
+
+        nav_search_context& context = get_thread_search_context();
+        nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            nav_search_flow_field(*this, context, field, max_cost, policy);
+        });
+    }
+
+    const nav_tactical_spot_t* nav_file::get_nearest_hidden_spot(vec3_t position, vec3_t threat, float max_distance,
+        std::uint8_t required_flags) const {
+        // the row of the threat's area is the visible set as is, it includes the area itself
+        const std::uint64_t* visible = m_visibility.get_row(get_area_index(get_nearest_area_by_position(threat)));
+
+        std::uint32_t spot_index = m_tactical.get_nearest_hidden_spot(position, visible, max_distance, required_flags);
+        if (spot_index == NAV_INVALID_INDEX) {
+            return nullptr;
+        }
+
+        return &m_tactical.get_spots()[spot_index];
+    }
+
+    nav_path_status nav_file::get_spots_along_path(vec3_t from, vec3_t to, std::vector< std::uint32_t >& spots,
+        const nav_path_options_t& options) const {
+        std::size_t start = get_area_index(get_nearest_area_by_position(from));
+        std::size_t goal = get_area_index(get_nearest_area_by_position(to));
+        spots.clear();
+
+        // a single area has nothing to pass through
+        if (start == goal) {
+            return nav_path_status::start_end_same;
+        }
+
+        if (!m_components.may_reach(start, goal)) {
+            return nav_path_status::no_solution;
+        }
+
+        nav_search_context& context = get_thread_search_context();
+        nav_path_status status = solve_path(context, start, goal, options);
+        if (status != nav_path_status::no_solution) {
+            m_tactical.get_spots_along_path(context.m_path.data(), context.m_path.size(), spots);
+        }
+
+        return status;
+    }
+
+    namespace {
+        constexpr std::uint32_t path_cache_file_magic = 0x4E504331; // NPC1
+        // start, goal, options tag, cost, hits and path count in front of the path of every entry
+        constexpr std::size_t path_cache_entry_header_size = 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(float) +
+            2 * sizeof(std::uint32_t);
+    }
+
+    void nav_file::save_path_cache(std::string_view file, std::size_t max_entries) const {
+        std::vector< nav_path_cache_entry_t > entries;
+        m_path_cache->get_hottest(max_entries, entries);
+
+        std::ofstream out(std::string(file), std::ios::binary);
+        if (!out.is_open())
+            throw std::runtime_error("nav_file::save_path_cache: couldn't open file");
+
+        auto write = [&](const auto& value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+        // an unsolvable pair may only be so because of a closed door, and a later load starts with every door open
+        auto is_persistent = [&](const nav_path_cache_entry_t& entry) {
+            return entry.key.overlay_version == 0 && entry.key.graph_version == m_loaded_graph_version && !entry.path.empty();
+        };
+
+        std::uint32_t entry_count = 0;
+        for (const auto& entry : entries)
+            entry_count += is_persistent(entry);
+
+        write(path_cache_file_magic);
+        write(m_map_hash);
+        write(entry_count);
+
+        // areas are stored by id so the file doesn't depend on the in memory area order
+        for (const auto& entry : entries) {
+            if (!is_persistent(entry))
+                continue;
+
+            write(m_areas[entry.key.start].get_id());
+            write(m_areas[entry.key.goal].get_id());
+            write(entry.key.options_tag);
+            write(entry.cost);
+            write(entry.hits);
+            write(static_cast<std::uint32_t>(entry.path.size()));
+            for (std::uint32_t area_index : entry.path)
+                write(m_areas[area_index].get_id());
+        }
+    }
+
+    bool nav_file::read_path_cache_file(std::string_view file, std::vector< nav_path_cache_entry_t >& entries) const {
+        entries.clear();
+
+        if (!std::ifstream(std::string(file), std::ios::binary).is_open())
+            return false;
+
+        nav_buffer buffer;
+        buffer.load_from_file(file);
+
+        if (buffer.get_remaining() < 16 || buffer.read< std::uint32_t >() != path_cache_file_magic ||
+            buffer.read< std::uint64_t >() != m_map_hash)
+            return false;
+
+        auto read_index = [&](std::uint32_t id, std::uint32_t& index) {
+            auto found = m_area_ids_to_indices.find(id);
+            index = found == m_area_ids_to_indices.end() ? NAV_INVALID_INDEX : static_cast<std::uint32_t>(found->second);
+            return index != NAV_INVALID_INDEX;
+        };
+
+        auto entry_count = buffer.read< std::uint32_t >();
+        for (std::uint32_t i = 0; i < entry_count; i++) {
+            if (buffer.get_remaining() < path_cache_entry_header_size)
+                return false;
+
+            nav_path_cache_entry_t entry;
+            bool valid = read_index(buffer.read< std::uint32_t >(), entry.key.start);
+            valid &= read_index(buffer.read< std::uint32_t >(), entry.key.goal);
+            // saved paths are on the connections as loaded, they never match once the graph was edited
+            entry.key.graph_version = m_loaded_graph_version;
+            entry.key.options_tag = buffer.read< std::uint64_t >();
+            entry.cost = buffer.read< float >();
+            entry.hits = buffer.read< std::uint32_t >();
+
+            auto path_count = buffer.read< std::uint32_t >();
+            if (buffer.get_remaining() < path_count * sizeof(std::uint32_t))
+                return false;
+
+            entry.path.resize(path_count);
+            for (std::uint32_t j = 0; j < path_count; j++)
+                valid &= read_index(buffer.read< std::uint32_t >(), entry.path[j]);
+
+            if (valid)
+                entries.push_back(std::move(entry));
+        }
+
+        return true;
+    }
+
+    std::size_t nav_file::load_path_cache(std::string_view file) {
+        std::vector< nav_path_cache_entry_t > entries;
+        read_path_cache_file(file, entries);
+
+        for (const auto& entry : entries)
+            m_path_cache->insert(entry.key, entry.path.data(), entry.path.size(), entry.cost, entry.hits);
+
+        return entries.size();
+    }
+
+    std::future< std::size_t > nav_file::warm_path_cache(std::string_view file, const nav_path_options_t& options,
+        std::size_t max_pairs) const {
+        auto entries = std::make_shared< std::vector< nav_path_cache_entry_t > >();
+        read_path_cache_file(file, *entries);
+
+        return m_path_cache_warm_up->start([this, entries, options, max_pairs](const std::atomic< bool >& cancelled) {
+            std::size_t solved_count = 0;
+            std::uint64_t options_tag = get_path_cache_tag(options);
+            nav_search_context& context = get_thread_search_context();
+
+            // without a flag of the caller's, a stop also ends the search under way
+            nav_path_options_t search_options = options;
+            if (!search_options.cancelled)
+                search_options.cancelled = &cancelled;
+
+            for (const auto& entry : *entries) {
+                if (solved_count == max_pairs || cancelled)
+                    break;
+
+                // a pair saved for other options would be solved into an entry nobody asked for
+                if (entry.key.options_tag != options_tag || entry.key.start == entry.key.goal ||
+                    !m_components.may_reach(entry.key.start, entry.key.goal))
+                    continue;
+
+                solve_path(context, entry.key.start, entry.key.goal, search_options);
+                solved_count++;
+            }
+
+            return solved_count;
+        });
+    }
+
+    nav_path_cache_key_t nav_file::get_path_cache_key(std::size_t start, std::size_t goal, const nav_path_options_t& options) const {
+        nav_path_cache_key_t key;
+        key.start = static_cast<std::uint32_t>(start);
+        key.goal = static_cast<std::uint32_t>(goal);
+        key.overlay_version = options.overlay ? options.overlay->get_version() : 0;
+        key.graph_version = m_graph_version;
+        key.options_tag = get_path_cache_tag(options);
+
+        return key;
+    }
+
+    nav_path_status nav_file::solve_path(nav_search_context& context, std::size_t start, std::size_t goal, const nav_path_options_t& options,
+        nav_path_stats_t* stats, const std::atomic< bool >* request_cancelled) const {
+        nav_path_status status;
+        float cost = FLT_MAX;
+        bool bounded = true;
+
+        if (!options.use_path_cache || !m_path_cache) {
+            status = search_path(context, start, goal, options, bounded, request_cancelled);
+            cost = context.get_cost(context.m_best);
+        }
+        else {
+            nav_path_cache_key_t key = get_path_cache_key(start, goal, options);
+
+            if (m_path_cache->find(key, context.m_path, cost)) {
+                find_path_connections(context.m_path.data(), context.m_path.size(), options, context.m_path_connections);
+                if (stats) {
+                    stats->cost = cost;
+                    // the key tells coarse searches apart, but not whether the corridor or the full search found the path
+                    stats->suboptimality_bound = options.use_coarse_graph ? FLT_MAX : options.heuristic_weight;
+                    stats->from_cache = true;
                 }
-                bool x_lesser = last_area_x_lesser || area_x_lesser;
-                vec3_t middle;
-                if (x_lesser) {
-                    middle.x = last_area_x_lesser ? area.m_nw_corner.x : last_area.m_nw_corner.x;
-                    float max_valid_y = std::min(area.m_se_corner.y, last_area.m_se_corner.y);
-                    float min_valid_y = std::max(area.m_nw_corner.y, last_area.m_nw_corner.y);
-                    middle.y = (max_valid_y + min_valid_y) / 2.f;
+
+                return context.m_path.empty() ? nav_path_status::no_solution : nav_path_status::solved;
+            }
+
+            // the path and its cost come straight out of the search state, nothing is recomputed.
+            // partial paths depend on the budget, so only finished searches are cached
+            status = search_path(context, start, goal, options, bounded, request_cancelled);
+            cost = context.get_cost(context.m_best);
+            if (status == nav_path_status::solved) {
+                m_path_cache->insert(key, context.m_path.data(), context.m_path.size(), cost);
+            }
+            else if (status == nav_path_status::no_solution) {
+                m_path_cache->insert(key, nullptr, 0, FLT_MAX);
+            }
+        }
+
+        if (stats) {
+            stats->cost = status == nav_path_status::no_solution ? FLT_MAX : cost;
+            stats->suboptimality_bound = status == nav_path_status::partial || !bounded ? FLT_MAX : options.heuristic_weight;
+            stats->expansions = context.m_expansions;
+        }
+
+        return status;
+    }
+
+    nav_path_status nav_file::search_path(nav_search_context& context, std::size_t start, std::size_t goal, const nav_path_options_t& options,
+        bool& bounded, const std::atomic< bool >* request_cancelled) const {
+        if (options.use_coarse_graph && m_coarse_graph.is_built()) {
+            thread_local std::vector< std::uint64_t > allowed_nodes;
+
+            if (m_coarse_graph.find_corridor(start, goal, allowed_nodes, options.use_ladders)) {
+                nav_path_status status = nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+                    nav_coarse_corridor_cost< std::decay_t< decltype(policy) > > corridor_policy(policy, m_coarse_graph, allowed_nodes);
+                    nav_search_astar_begin(*this, context, start, goal, corridor_policy, options.heuristic_weight);
+                    return nav_search_astar_resume(*this, context, goal, corridor_policy, options.max_expansions, options.deadline,
+                        options.cancelled, request_cancelled);
+                });
+
+                // no_solution only says the corridor was a dead end, the full search below has the last word
+                if (status != nav_path_status::no_solution) {
+                    context.build_path(start, context.m_best);
+                    bounded = false;
+                    return status;
+                }
+            }
+        }
+
+        nav_path_status status = nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            nav_search_astar_begin(*this, context, start, goal, policy, options.heuristic_weight);
+            return nav_search_astar_resume(*this, context, goal, policy, options.max_expansions, options.deadline,
+                options.cancelled, request_cancelled);
+        });
+
+        if (status != nav_path_status::no_solution) {
+            context.build_path(start, context.m_best);
+        }
+
+        return status;
+    }
+
+    void nav_file::build_path_output(nav_search_context& context, nav_path_status status, vec3_t from, vec3_t to,
+        const nav_path_options_t& options, std::vector< vec3_t >& path) const {
+        // a partial path ends at the center of the area that got closest to the goal
+        vec3_t end = status == nav_path_status::partial ? m_area_centers[context.m_path.back()] : to;
+
+        if (options.output == nav_path_output::straightened) {
+            straighten_path(context, from, end);
+            for (const auto& corner : context.m_corners) {
+                path.push_back(corner.pos);
+            }
+        }
+        else {
+            build_path_points(context.m_path.data(), context.m_path.size(), end, path, context.m_path_connections.data());
+            if (status == nav_path_status::partial)
+                path.pop_back();
+        }
+    }
+
+    void nav_file::build_path_output(nav_search_context& context, nav_path_status status, vec3_t from, vec3_t to,
+        const nav_path_options_t& options, std::vector< PathNode >& path) const {
+        std::uint32_t last_area_id = m_areas[context.m_path.back()].get_id();
+        vec3_t end = status == nav_path_status::partial ? m_area_centers[context.m_path.back()] : to;
+
+        if (options.output == nav_path_output::straightened) {
+            straighten_path(context, from, end);
+            for (const auto& corner : context.m_corners) {
+                if (corner.portal < context.m_portals.size()) {
+                    path.push_back({ true, m_areas[context.m_path[corner.portal]].get_id(),
+                        m_areas[context.m_path[corner.portal + 1]].get_id(), corner.pos });
                 }
                 else {
-                    middle.y = last_area_y_lesser ? area.m_nw_corner.y : last_area.m_nw_corner.y;
-                    float max_valid_x = std::min(area.m_se_corner.x, last_area.m_se_corner.x);
-                    float min_valid_x = std::max(area.m_nw_corner.x, last_area.m_nw_corner.x);
-                    middle.x = (max_valid_x + min_valid_x) / 2.f;
+                    path.push_back({ false, last_area_id, 0, end });
+                }
+            }
+        }
+        else {
+            build_path_nodes(context.m_path.data(), context.m_path.size(), end, path, context.m_path_connections.data());
+            if (status == nav_path_status::partial)
+                path.pop_back();
+        }
+    }
 
+    void nav_file::find_path_connections(const std::uint32_t* area_indices, std::size_t count, const nav_path_options_t& options,
+        std::vector< std::uint32_t >& path_connections) const {
+        path_connections.assign(count, NAV_INVALID_INDEX);
+
+        nav_dispatch_cost_profile(*this, options, [&](const auto& policy) {
+            for (std::size_t i = 1; i < count; i++) {
+                // the search relaxes the connections of an area in order and keeps the first of equal costs
+                float best_cost = FLT_MAX;
+                std::size_t first = connections_area_start[area_indices[i - 1]],
+                    last = first + connections_area_length[area_indices[i - 1]];
+
+                for (std::size_t c = first; c < last; c++) {
+                    if (connections[c] != area_indices[i] || !policy.allows_connection(c))
+                        continue;
+
+                    float cost = policy.get_connection_cost(c);
+                    if (path_connections[i] == NAV_INVALID_INDEX || cost < best_cost) {
+                        path_connections[i] = static_cast<std::uint32_t>(c);
+                        best_cost = cost;
+                    }
                 }
-                // if falling off cliff, never able to hit half way between top and bottom
-                // same logic if jumping
-                // take bottom z
-                middle.z = last_area.get_center().z;
-                path.push_back({ true, last_area.get_id(), area.get_id(), middle });
             }
-            path.push_back({ false, area.get_id(), 0, area.get_center() });
+        });
+    }
+
+    void nav_file::build_path_points(const std::uint32_t* area_indices, std::size_t count, vec3_t to, std::vector< vec3_t >& path,
+        const std::uint32_t* path_connections) const {
+        for (std::size_t i = 0; i < count; i++) {
+            // smooth paths by adding the middle of the edge shared with the previous area,
+            // as this will have max distance on either side for player to fit through. ladders are entered at their end
+            // and nothing in between if the areas aren't connected (anymore)
+            std::size_t connection = i == 0 ? NAV_INVALID_INDEX
+                : path_connections ? path_connections[i] : find_connection(area_indices[i - 1], area_indices[i]);
+            if (connection != NAV_INVALID_INDEX) {
+                vec3_t middle = connections_portals[connection].middle;
+                if (connections_kind[connection] == nav_connection_kind::walk)
+                    middle.z = (m_area_centers[area_indices[i]].z + m_area_centers[area_indices[i - 1]].z) / 2.f;
+                path.push_back(middle);
+            }
+            path.push_back(m_area_centers[area_indices[i]]);
         }
 
-        path.push_back({ false, get_nearest_area_by_position(to).get_id(), 0, to });
+        path.push_back(to);
+    }
 
-        return path;
+    void nav_file::build_path_nodes(const std::uint32_t* area_indices, std::size_t count, vec3_t to, std::vector< PathNode >& path,
+        const std::uint32_t* path_connections) const {
+        for (std::size_t i = 0; i < count; i++) {
+            std::uint32_t area_id = m_areas[area_indices[i]].get_id();
+            std::size_t connection = i == 0 ? NAV_INVALID_INDEX
+                : path_connections ? path_connections[i] : find_connection(area_indices[i - 1], area_indices[i]);
+            if (connection != NAV_INVALID_INDEX) {
+                std::uint32_t last_area_id = m_areas[area_indices[i - 1]].get_id();
+                // portal middles take the bottom z, if falling off cliff never able to hit half way between top and bottom
+                path.push_back({ true, last_area_id, area_id, connections_portals[connection].middle });
+            }
+            path.push_back({ false, area_id, 0, m_area_centers[area_indices[i]] });
+        }
+
+        path.push_back({ false, m_areas[area_indices[count - 1]].get_id(), 0, to });
+    }
+
+    void nav_file::straighten_path(nav_search_context& context, vec3_t from, vec3_t to) const {
+        context.m_portals.clear();
+        for (std::size_t i = 1; i < context.m_path.size(); i++) {
+            std::size_t connection = context.m_path_connections[i];
+            if (connection != NAV_INVALID_INDEX) {
+                context.m_portals.push_back(connections_portals[connection]);
+                continue;
+            }
+
+            // areas that aren't connected are passed between their centers
+            nav_portal_t portal;
+            vec3_t center = m_area_centers[context.m_path[i - 1]];
+            portal.left = portal.right = portal.middle = (center + m_area_centers[context.m_path[i]]) * .5f;
+            context.m_portals.push_back(portal);
+        }
+
+        context.m_corners.clear();
+        nav_string_pull(from, to, context.m_portals.data(), context.m_portals.size(), context.m_corners);
+    }
+
+    float nav_file::get_portal_path_length(const nav_search_context& context, std::size_t start, std::size_t goal, vec3_t from, vec3_t to) const {
+        float length = 0.f;
+        vec3_t last_point = to;
+
+        for (std::size_t area_index = goal; area_index != start; area_index = context.get_parent(area_index)) {
+            vec3_t point = connections_portals[context.get_parent_connection(area_index)].middle;
+            length += nav_distance(point, last_point);
+            last_point = point;
+        }
+
+        return length + nav_distance(from, last_point);
+    }
+
+    nav_raycast_result_t nav_file::raycast(vec3_t from, vec3_t to, std::uint32_t* areas, std::size_t max_areas) const {
+        return raycast(get_area_index(get_nearest_area_by_position(from)), from, to, areas, max_areas);
+    }
+
+    nav_raycast_result_t nav_file::raycast(std::size_t start_index, vec3_t from, vec3_t to, std::uint32_t* areas,
+        std::size_t max_areas) const {
+        // neighbouring areas share their edges exactly in the file, this only absorbs float error
+        constexpr float edge_tolerance = .01f;
+
+        nav_raycast_result_t result;
+        float dx = to.x - from.x, dy = to.y - from.y;
+
+        // fraction of the segment at which it leaves the xy bounds of an area
+        auto get_exit = [&](const nav_area& area) {
+            float exit_x = dx > 0.f ? (area.m_se_corner.x - from.x) / dx : dx < 0.f ? (area.m_nw_corner.x - from.x) / dx : FLT_MAX;
+            float exit_y = dy > 0.f ? (area.m_se_corner.y - from.y) / dy : dy < 0.f ? (area.m_nw_corner.y - from.y) / dy : FLT_MAX;
+            return std::min(exit_x, exit_y);
+        };
+
+        auto contains = [&](const nav_area& area, float x, float y) {
+            return x >= area.m_nw_corner.x - edge_tolerance && x <= area.m_se_corner.x + edge_tolerance &&
+                y >= area.m_nw_corner.y - edge_tolerance && y <= area.m_se_corner.y + edge_tolerance;
+        };
+
+        std::size_t area_index = start_index;
+
+        // off the start area from the beginning, nothing of the segment is on the mesh
+        if (!contains(m_areas[area_index], from.x, from.y)) {
+            result.hit = true;
+            result.t = 0.f;
+            result.area_index = static_cast<std::uint32_t>(area_index);
+            result.position = { from.x, from.y, m_areas[area_index].get_z(from.x, from.y) };
+            return result;
+        }
+
+        for (;;) {
+            if (result.area_count < max_areas)
+                areas[result.area_count] = static_cast<std::uint32_t>(area_index);
+            result.area_count++;
+
+            float exit = get_exit(m_areas[area_index]);
+            if (exit >= 1.f) {
+                result.area_index = static_cast<std::uint32_t>(area_index);
+                result.position = { to.x, to.y, m_areas[area_index].get_z(to.x, to.y) };
+                return result;
+            }
+
+            // the neighbour the exit point lies on, which carries the segment the furthest. t has to grow with
+            // every step, which rules out loops and neighbours the segment only grazes at a corner
+            float exit_x = from.x + dx * exit, exit_y = from.y + dy * exit;
+            std::size_t next_index = NAV_INVALID_INDEX;
+            float next_exit = exit;
+
+            std::size_t first = connections_area_start[area_index],
+                last = first + connections_area_length[area_index];
+            for (std::size_t i = first; i < last; i++) {
+                const nav_area& next_area = m_areas[connections[i]];
+                if (connections_kind[i] != nav_connection_kind::walk || !contains(next_area, exit_x, exit_y))
+                    continue;
+
+                float candidate_exit = get_exit(next_area);
+                if (candidate_exit > next_exit) {
+                    next_exit = candidate_exit;
+                    next_index = connections[i];
+                }
+            }
+
+            if (next_index == NAV_INVALID_INDEX) {
+                result.hit = true;
+                result.t = exit;
+                result.area_index = static_cast<std::uint32_t>(area_index);
+                result.position = { exit_x, exit_y, m_areas[area_index].get_z(exit_x, exit_y) };
+                return result;
+            }
+
+            area_index = next_index;
+        }
+    }
+
+    float nav_file::compute_path_length(const std::vector< PathNode >& path) const {
+        return compute_path_length(path.data(), path.size());
     }
 
-    float nav_file::compute_path_length(std::vector< PathNode > path) {
+    float nav_file::compute_path_length(const PathNode* path, std::size_t count) const {
         float total_distance = 0;
-        for (size_t i = 1; i < path.size(); i++) {
-            auto local_distance = path[i].pos - path[i - 1].pos;
-            total_distance += sqrtf(local_distance.x * local_distance.x +
-                local_distance.y * local_distance.y + local_distance.z * local_distance.z);
+        for (size_t i = 1; i < count; i++) {
+            total_distance += nav_distance(path[i].pos, path[i - 1].pos);
         }
         return total_distance;
     }
 
-    float nav_file::compute_path_length_from_origin(vec3_t origin, std::vector< PathNode > path) {
-        path.push_back({ false, 0, 0, origin });
-        return compute_path_length(path);
+    float nav_file::compute_path_length_from_origin(vec3_t origin, const std::vector< PathNode >& path) const {
+        return compute_path_length_from_origin(origin, path.data(), path.size());
+    }
+
+    float nav_file::compute_path_length_from_origin(vec3_t origin, const PathNode* path, std::size_t count) const {
+        // same as measuring the path with origin appended as its last node, without copying it
+        if (count == 0) {
+            return 0.f;
+        }
+        return compute_path_length(path, count) + nav_distance(origin, path[count - 1].pos);
     }
 
     const nav_area& nav_file::get_area_by_id(std::uint32_t id) const {
@@ -224,6 +1027,14 @@ namespace nav_mesh {
         return m_areas[m_area_ids_to_indices.find(id)->second];
     }
 
+    std::size_t nav_file::get_area_index(std::uint32_t id) const {
+        auto indexResult = m_area_ids_to_indices.find(id);
+        if (indexResult == m_area_ids_to_indices.end())
+            throw std::runtime_error("nav_file::get_area_index: failed to find area");
+
+        return indexResult->second;
+    }
+
     std::string nav_file::get_place(std::uint16_t id) const {
         if (id < m_places.size()) {
             std::string result = m_places[id];
@@ -306,7 +1117,7 @@ namespace nav_mesh {
                 (void)x;
             }
             // skip bugged areas with no connections
-            if (area.m_connections.empty()) {
+            if (connections_area_length[get_area_index(area)] == 0) {
                 continue;
             }
             if (area.is_within_3d(position)) {
@@ -339,7 +1150,7 @@ namespace nav_mesh {
         for (size_t area_id = 0; area_id < m_areas.size(); area_id++) {
             const nav_area& area = m_areas[area_id];
             // skip bugged areas with no connections
-            if (area.m_connections.empty()) {
+            if (connections_area_length[get_area_index(area)] == 0) {
                 continue;
             }
             if (area.is_within_3d(position)) {
@@ -381,7 +1192,7 @@ namespace nav_mesh {
         for (size_t area_id = 0; area_id < m_areas.size(); area_id++) {
             const nav_area& area = m_areas[area_id];
             // skip bugged areas with no connections
-            if (area.m_connections.empty()) {
+            if (connections_area_length[get_area_index(area)] == 0) {
                 continue;
             }
             if (area.m_place != place_id) {
@@ -406,12 +1217,44 @@ namespace nav_mesh {
 
     }
 
+    const nav_area& nav_file::get_nearest_area_by_position_in_component(vec3_t position, std::uint32_t reference_area_id) const {
+        float nearest_area_distance = std::numeric_limits<float>::max();
+        size_t nearest_area_id = -1;
+        size_t reference_area_index = get_area_index(reference_area_id);
+
+        for (size_t area_id = 0; area_id < m_areas.size(); area_id++) {
+            const nav_area& area = m_areas[area_id];
+            // skip bugged areas with no connections
+            if (connections_area_length[get_area_index(area)] == 0) {
+                continue;
+            }
+            if (!m_components.is_same_strong(area_id, reference_area_index)) {
+                continue;
+            }
+            if (area.is_within_3d(position)) {
+                return area;
+            }
+            float other_distance = get_point_to_area_distance(position, area);
+            if (other_distance < nearest_area_distance) {
+                nearest_area_distance = other_distance;
+                nearest_area_id = area_id;
+            }
+        }
+
+        if (nearest_area_id == static_cast<size_t>(-1)) {
+            throw std::runtime_error("nav_file::get_nearest_area_by_position_in_component: no areas");
+        }
+        else {
+            return m_areas[nearest_area_id];
+        }
+    }
+
     std::vector<AreaDistance> nav_file::get_area_distances_to_position(vec3_t position) const {
         std::vector<AreaDistance> result;
         for (size_t area_id = 0; area_id < m_areas.size(); area_id++) {
             const nav_area& area = m_areas[area_id];
             // skip bugged areas with no connections
-            if (area.m_connections.empty()) {
+            if (connections_area_length[get_area_index(area)] == 0) {
                 continue;
             }
             result.push_back({ area.get_id(), get_point_to_area_distance(position, area) });
@@ -422,58 +1265,513 @@ namespace nav_mesh {
         return result;
     }
 
-    void nav_file::remove_incoming_edges_to_areas(std::set<std::uint32_t> ids) {
-        for (size_t area_index = 0; area_index < m_areas.size(); area_index++) {
-            std::vector< nav_connect_t >& area_connections = m_areas[area_index].m_connections;
-            area_connections.erase(std::remove_if(
-                area_connections.begin(),
-                area_connections.end(),
-                [&](nav_connect_t con) { return ids.find(con.id) != ids.end(); }),
-                area_connections.end());
+    void nav_file::remove_incoming_edges_to_areas(std::set<std::uint32_t> ids, bool use_ladders) {
+        std::vector< std::pair< std::size_t, std::size_t > > removed_edges;
+        for (std::uint32_t id : ids) {
+            auto target = m_area_ids_to_indices.find(id);
+            if (target == m_area_ids_to_indices.end())
+                continue;
+
+            // only the sources of the target are touched, each removal shifts the rest of the reverse slice down
+            std::size_t reverse = reverse_connections_area_start[target->second];
+            while (reverse != reverse_connections_area_start[target->second] + reverse_connections_area_length[target->second]) {
+                if (!use_ladders && connections_kind[reverse_connections_edge[reverse]] != nav_connection_kind::walk) {
+                    reverse++;
+                    continue;
+                }
+
+                removed_edges.push_back({ reverse_connections[reverse], target->second });
+                remove_connection(reverse_connections[reverse], reverse_connections_edge[reverse]);
+            }
         }
-        build_connections_arrays();
-        m_pather->Reset();
+
+        on_connections_changed();
+        m_components.update_after_removal(*this, removed_edges);
     }
 
     void nav_file::remove_edges(std::set<std::pair<std::uint32_t, std::uint32_t>> ids) {
-        for (size_t area_index = 0; area_index < m_areas.size(); area_index++) {
-            std::vector< nav_connect_t >& area_connections = m_areas[area_index].m_connections;
-            std::int32_t srcId = m_areas[area_index].get_id();
-            area_connections.erase(std::remove_if(
-                area_connections.begin(),
-                area_connections.end(),
-                [&](nav_connect_t con) {
-                    return ids.find({ srcId, con.id }) != ids.end() || ids.find({ con.id, srcId }) != ids.end();
-                }),
-                area_connections.end());
+        std::vector< std::pair< std::size_t, std::size_t > > removed_edges;
+        auto remove_all = [&](std::size_t area_index, std::size_t next_index) {
+            std::size_t connection;
+            while ((connection = find_connection(area_index, next_index)) != NAV_INVALID_INDEX) {
+                removed_edges.push_back({ area_index, next_index });
+                remove_connection(area_index, connection);
+            }
+        };
+
+        for (const auto& [a, b] : ids) {
+            auto a_index = m_area_ids_to_indices.find(a);
+            auto b_index = m_area_ids_to_indices.find(b);
+            if (a_index == m_area_ids_to_indices.end() || b_index == m_area_ids_to_indices.end())
+                continue;
+
+            // either direction goes, like it always has
+            remove_all(a_index->second, b_index->second);
+            remove_all(b_index->second, a_index->second);
         }
-        build_connections_arrays();
+
+        on_connections_changed();
+        m_components.update_after_removal(*this, removed_edges);
+    }
+
+    void nav_file::restore_incoming_edges_to_areas(std::set<std::uint32_t> ids) {
+        std::vector< std::pair< std::size_t, std::size_t > > restored_edges;
+        for (std::uint32_t id : ids) {
+            auto target = m_area_ids_to_indices.find(id);
+            if (target == m_area_ids_to_indices.end())
+                continue;
+
+            // restoring takes the first removed entry out of the reverse slack until it is empty
+            std::size_t first = reverse_connections_area_start[target->second],
+                last = get_reverse_connections_end(target->second);
+
+            while (first + reverse_connections_area_length[target->second] != last) {
+                std::size_t reverse = first + reverse_connections_area_length[target->second];
+                restored_edges.push_back({ reverse_connections[reverse], target->second });
+                restore_connection(reverse_connections[reverse], reverse_connections_edge[reverse]);
+            }
+        }
+
+        on_connections_changed();
+        m_components.update_after_addition(*this, restored_edges);
+    }
+
+    void nav_file::restore_edges(std::set<std::pair<std::uint32_t, std::uint32_t>> ids) {
+        std::vector< std::pair< std::size_t, std::size_t > > restored_edges;
+        auto restore_all = [&](std::size_t area_index, std::size_t next_index) {
+            std::size_t first = connections_area_start[area_index],
+                last = get_connections_end(area_index);
+
+            // removed connections sit in the slack after the slice, restoring one moves it to the front of the slack
+            for (std::size_t i = first + connections_area_length[area_index]; i < last;) {
+                if (connections[i] != next_index) {
+                    i++;
+                    continue;
+                }
+
+                // another removed connection may have been swapped into i, so only move on once i is in the slice
+                restored_edges.push_back({ area_index, next_index });
+                restore_connection(area_index, i);
+                i = std::max(i, first + connections_area_length[area_index]);
+            }
+        };
+
+        for (const auto& [a, b] : ids) {
+            auto a_index = m_area_ids_to_indices.find(a);
+            auto b_index = m_area_ids_to_indices.find(b);
+            if (a_index == m_area_ids_to_indices.end() || b_index == m_area_ids_to_indices.end())
+                continue;
+
+            restore_all(a_index->second, b_index->second);
+            restore_all(b_index->second, a_index->second);
+        }
+
+        on_connections_changed();
+        m_components.update_after_addition(*this, restored_edges);
+    }
+
+    void nav_file::build_coarse_graph() {
+        m_coarse_graph.build(*this);
+    }
+
+    void nav_file::on_connections_changed() {
+        m_graph_version++;
+        m_path_cache->clear();
         m_pather->Reset();
     }
 
+    std::size_t nav_file::get_connections_end(std::size_t area_index) const {
+        return area_index + 1 < m_areas.size() ? connections_area_start[area_index + 1] : connections.size();
+    }
+
+    std::size_t nav_file::get_reverse_connections_end(std::size_t area_index) const {
+        return area_index + 1 < m_areas.size() ? reverse_connections_area_start[area_index + 1] : reverse_connections.size();
+    }
+
+    std::size_t nav_file::find_reverse_connection(std::size_t connection) const {
+        std::size_t target = connections[connection],
+            last = get_reverse_connections_end(target);
+
+        for (std::size_t i = reverse_connections_area_start[target]; i < last; i++) {
+            if (reverse_connections_edge[i] == connection)
+                return i;
+        }
+
+        return NAV_INVALID_INDEX;
+    }
+
+    void nav_file::remove_connection(std::size_t area_index, std::size_t connection) {
+        std::size_t first = connections_area_start[area_index],
+            last = first + connections_area_length[area_index];
+
+        // rotate the reverse entry to the end of the slice, shifting the rest down keeps the sources sorted
+        std::size_t target = connections[connection],
+            reverse = find_reverse_connection(connection),
+            reverse_last = reverse_connections_area_start[target] + reverse_connections_area_length[target];
+
+        std::size_t removed_source = reverse_connections[reverse];
+        for (std::size_t i = reverse + 1; i < reverse_last; i++) {
+            reverse_connections[i - 1] = reverse_connections[i];
+            reverse_connections_edge[i - 1] = reverse_connections_edge[i];
+        }
+        reverse_connections[reverse_last - 1] = removed_source;
+        reverse_connections_edge[reverse_last - 1] = last - 1;
+        reverse_connections_area_length[target]--;
+
+        // same for the connection, so the order still matches m_connections. the reverse entries follow
+        // m_connections only lists the walk connections, in the order they have in the slice
+        std::size_t walk_index = std::count(connections_kind.begin() + first, connections_kind.begin() + connection, nav_connection_kind::walk);
+
+        nav_portal_t removed_portal = connections_portals[connection];
+        float removed_clearance = connections_clearance[connection],
+            removed_extra_cost = connections_extra_cost[connection];
+        nav_connection_kind removed_kind = connections_kind[connection];
+        for (std::size_t i = connection + 1; i < last; i++) {
+            reverse_connections_edge[find_reverse_connection(i)] = i - 1;
+            connections[i - 1] = connections[i];
+            connections_portals[i - 1] = connections_portals[i];
+            connections_clearance[i - 1] = connections_clearance[i];
+            connections_kind[i - 1] = connections_kind[i];
+            connections_extra_cost[i - 1] = connections_extra_cost[i];
+        }
+        connections[last - 1] = target;
+        connections_portals[last - 1] = removed_portal;
+        connections_clearance[last - 1] = removed_clearance;
+        connections_kind[last - 1] = removed_kind;
+        connections_extra_cost[last - 1] = removed_extra_cost;
+        connections_area_length[area_index]--;
+
+        if (removed_kind == nav_connection_kind::walk) {
+            std::vector< nav_connect_t >& area_connections = m_areas[area_index].m_connections;
+            area_connections.erase(area_connections.begin() + walk_index);
+        }
+    }
+
+    void nav_file::restore_connection(std::size_t area_index, std::size_t connection) {
+        std::size_t last = connections_area_start[area_index] + connections_area_length[area_index];
+
+        // swap the reverse entry to the front of the slack, then sift it down to its sorted place
+        std::size_t target = connections[connection],
+            reverse = find_reverse_connection(connection),
+            reverse_first = reverse_connections_area_start[target],
+            reverse_last = reverse_first + reverse_connections_area_length[target];
+
+        std::swap(reverse_connections[reverse], reverse_connections[reverse_last]);
+        std::swap(reverse_connections_edge[reverse], reverse_connections_edge[reverse_last]);
+
+        for (reverse = reverse_last; reverse > reverse_first && reverse_connections[reverse - 1] > reverse_connections[reverse]; reverse--) {
+            std::swap(reverse_connections[reverse - 1], reverse_connections[reverse]);
+            std::swap(reverse_connections_edge[reverse - 1], reverse_connections_edge[reverse]);
+        }
+        reverse_connections_area_length[target]++;
+
+        // the connection joins the end of the slice, trading places with whatever removed one was there
+        if (connection != last) {
+            reverse_connections_edge[find_reverse_connection(last)] = connection;
+            std::swap(connections[connection], connections[last]);
+            std::swap(connections_portals[connection], connections_portals[last]);
+            std::swap(connections_clearance[connection], connections_clearance[last]);
+            std::swap(connections_kind[connection], connections_kind[last]);
+            std::swap(connections_extra_cost[connection], connections_extra_cost[last]);
+        }
+        reverse_connections_edge[reverse] = last;
+        connections_area_length[area_index]++;
+
+        if (connections_kind[last] != nav_connection_kind::walk)
+            return;
+
+        // a walking connection goes back in front of the ladder connections, where find_connection looks first
+        std::size_t first = connections_area_start[area_index];
+        for (std::size_t i = last; i > first && connections_kind[i - 1] != nav_connection_kind::walk; i--) {
+            std::size_t reverse_ladder = find_reverse_connection(i - 1);
+            reverse_connections_edge[find_reverse_connection(i)] = i - 1;
+            reverse_connections_edge[reverse_ladder] = i;
+
+            std::swap(connections[i - 1], connections[i]);
+            std::swap(connections_portals[i - 1], connections_portals[i]);
+            std::swap(connections_clearance[i - 1], connections_clearance[i]);
+            std::swap(connections_kind[i - 1], connections_kind[i]);
+            std::swap(connections_extra_cost[i - 1], connections_extra_cost[i]);
+        }
+
+        m_areas[area_index].m_connections.push_back(nav_connect_t(m_areas[target].get_id()));
+    }
+
+    void nav_file::reorder_areas(nav_area_order order) {
+        if (order == nav_area_order::file || m_areas.size() < 2)
+            return;
+
+        std::vector< std::size_t > new_order(m_areas.size());
+
+        if (order == nav_area_order::hilbert) {
+            vec3_t min = m_areas[0].get_center(), max = min;
+            for (const auto& area : m_areas) {
+                vec3_t center = area.get_center();
+                min = { std::min(min.x, center.x), std::min(min.y, center.y), 0.f };
+                max = { std::max(max.x, center.x), std::max(max.y, center.y), 0.f };
+            }
+
+            float scale_x = max.x > min.x ? 65535.f / (max.x - min.x) : 0.f,
+                scale_y = max.y > min.y ? 65535.f / (max.y - min.y) : 0.f;
+
+            std::vector< std::uint64_t > keys(m_areas.size());
+            for (std::size_t i = 0; i < m_areas.size(); i++) {
+                vec3_t center = m_areas[i].get_center();
+                keys[i] = get_hilbert_index(static_cast<std::uint32_t>((center.x - min.x) * scale_x),
+                    static_cast<std::uint32_t>((center.y - min.y) * scale_y));
+            }
+
+            std::iota(new_order.begin(), new_order.end(), 0);
+            std::stable_sort(new_order.begin(), new_order.end(), [&](std::size_t a, std::size_t b) { return keys[a] < keys[b]; });
+        }
+        else {
+            // the maps aren't built yet, so the connections are resolved through a temporary one
+            std::unordered_map< std::uint32_t, std::size_t > ids_to_indices;
+            for (std::size_t i = 0; i < m_areas.size(); i++)
+                ids_to_indices.insert({ m_areas[i].get_id(), i });
+
+            // Cuthill-McKee works on the symmetric structure, one way connections count both ways
+            std::vector< std::vector< std::size_t > > neighbors(m_areas.size());
+            for (std::size_t i = 0; i < m_areas.size(); i++) {
+                for (const auto& connection : m_areas[i].get_connections()) {
+                    auto found = ids_to_indices.find(connection.id);
+                    if (found == ids_to_indices.end() || found->second == i)
+                        continue;
+
+                    neighbors[i].push_back(found->second);
+                    neighbors[found->second].push_back(i);
+                }
+            }
+
+            for (auto& area_neighbors : neighbors) {
+                std::sort(area_neighbors.begin(), area_neighbors.end());
+                area_neighbors.erase(std::unique(area_neighbors.begin(), area_neighbors.end()), area_neighbors.end());
+            }
+
+            for (auto& area_neighbors : neighbors) {
+                std::sort(area_neighbors.begin(), area_neighbors.end(), [&](std::size_t a, std::size_t b) {
+                    return neighbors[a].size() < neighbors[b].size();
+                });
+            }
+
+            // every component starts its breadth first pass from its lowest degree area
+            std::vector< std::size_t > by_degree(m_areas.size());
+            std::iota(by_degree.begin(), by_degree.end(), 0);
+            std::stable_sort(by_degree.begin(), by_degree.end(), [&](std::size_t a, std::size_t b) {
+                return neighbors[a].size() < neighbors[b].size();
+            });
+
+            std::vector< std::uint8_t > visited(m_areas.size(), 0);
+            std::size_t count = 0;
+            for (std::size_t root : by_degree) {
+                if (visited[root])
+                    continue;
+
+                visited[root] = 1;
+                new_order[count++] = root;
+
+                for (std::size_t head = count - 1; head < count; head++) {
+                    for (std::size_t next : neighbors[new_order[head]]) {
+                        if (visited[next])
+                            continue;
+
+                        visited[next] = 1;
+                        new_order[count++] = next;
+                    }
+                }
+            }
+
+            std::reverse(new_order.begin(), new_order.end());
+        }
+
+        std::vector< nav_area > areas;
+        areas.reserve(m_areas.size());
+        for (std::size_t area_index : new_order)
+            areas.push_back(std::move(m_areas[area_index]));
+
+        m_areas = std::move(areas);
+    }
+
     void nav_file::build_connections_arrays() {
+        struct ladder_edge_t {
+            size_t source, target, ladder;
+            nav_connection_kind kind;
+        };
+
+        // both ways between the bottom area of every ladder and each of its top areas, skipping areas that aren't there
+        std::vector< ladder_edge_t > ladder_edges;
+        for (size_t i = 0; i < m_ladders.size(); i++) {
+            const nav_ladder_t& ladder = m_ladders[i];
+            auto bottom = m_area_ids_to_indices.find(ladder.bottom_area);
+            if (ladder.bottom_area == 0 || bottom == m_area_ids_to_indices.end()) {
+                continue;
+            }
+
+            for (std::uint32_t top_area : { ladder.top_forward_area, ladder.top_left_area, ladder.top_right_area, ladder.top_behind_area }) {
+                auto top = m_area_ids_to_indices.find(top_area);
+                if (top_area == 0 || top == m_area_ids_to_indices.end() || top->second == bottom->second) {
+                    continue;
+                }
+
+                ladder_edges.push_back({ bottom->second, top->second, i, nav_connection_kind::ladder_up });
+                ladder_edges.push_back({ top->second, bottom->second, i, nav_connection_kind::ladder_down });
+            }
+        }
+
+        // grouped by source, one connection per area pair and direction even if several ladders or sides join them
+        auto ladder_edge_less = [](const ladder_edge_t& a, const ladder_edge_t& b) {
+            return std::tie(a.source, a.target, a.kind, a.ladder) < std::tie(b.source, b.target, b.kind, b.ladder);
+        };
+        auto ladder_edge_same = [](const ladder_edge_t& a, const ladder_edge_t& b) {
+            return a.source == b.source && a.target == b.target && a.kind == b.kind;
+        };
+        std::sort(ladder_edges.begin(), ladder_edges.end(), ladder_edge_less);
+        ladder_edges.erase(std::unique(ladder_edges.begin(), ladder_edges.end(), ladder_edge_same), ladder_edges.end());
+
         connections.clear();
         connections_area_start.clear();
         connections_area_length.clear();
+        connections_portals.clear();
+        connections_kind.clear();
+        connections_extra_cost.clear();
+
+        size_t ladder_edge = 0;
         for (size_t i = 0; i < m_areas.size(); i++) {
             connections_area_start.push_back(connections.size());
             for (const auto& connection : m_areas[i].get_connections()) {
-                connections.push_back(m_area_ids_to_indices.find(connection.id)->second);
+                size_t target = m_area_ids_to_indices.find(connection.id)->second;
+                connections.push_back(target);
+                connections_portals.push_back(compute_portal(m_areas[i], m_areas[target]));
+                connections_kind.push_back(nav_connection_kind::walk);
+                connections_extra_cost.push_back(0.f);
+            }
+
+            // a ladder connection passes through the end of the ladder it is entered from
+            for (; ladder_edge < ladder_edges.size() && ladder_edges[ladder_edge].source == i; ladder_edge++) {
+                const ladder_edge_t& edge = ladder_edges[ladder_edge];
+                const nav_ladder_t& ladder = m_ladders[edge.ladder];
+                bool up = edge.kind == nav_connection_kind::ladder_up;
+                vec3_t entry = up ? ladder.bottom : ladder.top,
+                    exit = up ? ladder.top : ladder.bottom;
+
+                nav_portal_t portal;
+                portal.left = portal.right = portal.middle = entry;
+                portal.width = ladder.width;
+
+                float length = nav_distance(m_area_centers[i], entry) + ladder.length + nav_distance(exit, m_area_centers[edge.target]);
+
+                connections.push_back(edge.target);
+                connections_portals.push_back(portal);
+                connections_kind.push_back(edge.kind);
+                connections_extra_cost.push_back(std::max(0.f, length - nav_distance(m_area_centers[i], m_area_centers[edge.target])));
             }
+
             connections_area_length.push_back(connections.size() - connections_area_start.back());
         }
+
+        connections_clearance.clear();
+        for (const auto& portal : connections_portals) {
+            connections_clearance.push_back(portal.width);
+        }
+
+        reverse_connections_area_length.assign(m_areas.size(), 0);
+        for (size_t target : connections) {
+            reverse_connections_area_length[target]++;
+        }
+
+        reverse_connections_area_start.assign(m_areas.size(), 0);
+        for (size_t i = 1; i < m_areas.size(); i++) {
+            reverse_connections_area_start[i] = reverse_connections_area_start[i - 1] + reverse_connections_area_length[i - 1];
+        }
+
+        // fill by walking the sources in order, so every target's sources end up sorted
+        std::vector<size_t> fill = reverse_connections_area_start;
+        reverse_connections.resize(connections.size());
+        reverse_connections_edge.resize(connections.size());
+        for (size_t i = 0; i < m_areas.size(); i++) {
+            for (size_t j = connections_area_start[i]; j < connections_area_start[i] + connections_area_length[i]; j++) {
+                reverse_connections_edge[fill[connections[j]]] = j;
+                reverse_connections[fill[connections[j]]++] = i;
+            }
+        }
     }
 
-    std::set<std::uint32_t> nav_file::get_sources_to_area(std::uint32_t id) const {
+    nav_portal_t nav_file::compute_portal(const nav_area& area, const nav_area& next_area) const {
+        // nw is min values, se is max value, so checking if x or y is the meeting point
+        bool area_x_lesser = area.get_max_corner().x <= next_area.get_min_corner().x;
+        bool next_area_x_lesser = next_area.get_max_corner().x <= area.get_min_corner().x;
+        bool area_y_lesser = area.get_max_corner().y <= next_area.get_min_corner().y;
+        // edges of cat cause overhang, causing overlapping areas in x and y. these fall through to the
+        // y case like they always have, doesn't seem to be a problem
+        float z = area.get_center().z;
+        vec3_t a, b;
+        if (area_x_lesser || next_area_x_lesser) {
+            float x = area_x_lesser ? next_area.m_nw_corner.x : area.m_nw_corner.x;
+            a = { x, std::max(area.m_nw_corner.y, next_area.m_nw_corner.y), z };
+            b = { x, std::min(area.m_se_corner.y, next_area.m_se_corner.y), z };
+        }
+        else {
+            float y = area_y_lesser ? next_area.m_nw_corner.y : area.m_nw_corner.y;
+            a = { std::max(area.m_nw_corner.x, next_area.m_nw_corner.x), y, z };
+            b = { std::min(area.m_se_corner.x, next_area.m_se_corner.x), y, z };
+        }
+
+        nav_portal_t portal;
+        portal.middle = { (a.x + b.x) / 2.f, (a.y + b.y) / 2.f, z };
+        portal.width = std::max(0.f, std::max(b.x - a.x, b.y - a.y));
+
+        // left is the endpoint counter clockwise of the travel direction
+        vec3_t direction = next_area.get_center() - area.get_center();
+        float a_side = direction.x * (a.y - area.get_center().y) - direction.y * (a.x - area.get_center().x);
+        float b_side = direction.x * (b.y - area.get_center().y) - direction.y * (b.x - area.get_center().x);
+        portal.left = a_side >= b_side ? a : b;
+        portal.right = a_side >= b_side ? b : a;
+
+        return portal;
+    }
+
+    std::size_t nav_file::find_connection(std::size_t area_index, std::size_t next_index) const {
+        std::size_t first = connections_area_start[area_index],
+            last = first + connections_area_length[area_index];
+
+        for (std::size_t i = first; i < last; i++) {
+            if (connections[i] == next_index)
+                return i;
+        }
+
+        return NAV_INVALID_INDEX;
+    }
+
+    std::set<std::uint32_t> nav_file::get_sources_to_area(std::uint32_t id, bool use_ladders) const {
         std::set<std::uint32_t> result;
-        for (size_t area_id = 0; area_id < m_areas.size(); area_id++) {
-            const std::vector< nav_connect_t >& area_connections = m_areas[area_id].m_connections;
-            for (const auto& con : area_connections) {
-                if (con.id == id) {
-                    result.insert(m_areas[area_id].get_id());
-                }
-            }
+        auto target = m_area_ids_to_indices.find(id);
+        if (target == m_area_ids_to_indices.end())
+            return result;
+
+        std::size_t first = reverse_connections_area_start[target->second],
+            last = first + reverse_connections_area_length[target->second];
+
+        for (std::size_t i = first; i < last; i++) {
+            if (use_ladders || connections_kind[reverse_connections_edge[i]] == nav_connection_kind::walk)
+                result.insert(m_areas[reverse_connections[i]].get_id());
         }
         return result;
     }
+
+    std::size_t nav_file::get_sources_to_area(std::size_t area_index, std::vector< std::uint32_t >& sources, bool use_ladders) const {
+        std::size_t first = reverse_connections_area_start[area_index],
+            last = first + reverse_connections_area_length[area_index];
+
+        sources.clear();
+        for (std::size_t i = first; i < last; i++) {
+            if (!use_ladders && connections_kind[reverse_connections_edge[i]] != nav_connection_kind::walk)
+                continue;
+
+            // a source with several connections to the area is listed once, they are adjacent since sources are sorted
+            if (sources.empty() || sources.back() != reverse_connections[i])
+                sources.push_back(static_cast<std::uint32_t>(reverse_connections[i]));
+        }
+
+        return sources.size();
+    }
 }
\ No newline at end of file
@@ -1,5 +1,13 @@
 #pragma once
 #include "nav_area.h"
+#include "nav_area_grid.h"
+#include "nav_async.h"
+#include "nav_coarse_graph.h"
+#include "nav_components.h"
+#include "nav_path_cache.h"
+#include "nav_query.h"
+#include "nav_tactical.h"
+#include "nav_visibility.h"
 #include "micropather.h"
 #include <cmath>
 #include <memory>
@@ -7,6 +15,7 @@
 #include <optional>
 #include <set>
 #include <algorithm>
+#include <future>
 #define NAV_INVALID (-1)
 
 #ifdef _WIN32
@@ -28,18 +37,79 @@ namespace nav_mesh {
         float distance;
     };
 
+    // order of the dense area indices, ids are never affected. reordering is opt-in: it only pays off when the file
+    // order is spatially incoherent, and it is not measured on a real map yet, see nav_parse --bench-orders
+    enum class nav_area_order : std::uint8_t {
+        // as stored in the nav file
+        file,
+        // along a Hilbert curve over the area centers, so areas close in space are close in memory
+        hilbert,
+        // reverse Cuthill-McKee over the connections, keeping the index distance of connected areas small
+        reverse_cuthill_mckee
+    };
+
     class DLL_EXPORT nav_file : public micropather::Graph {
         std::set< uint32_t > m_areas_to_increase_cost;
     public:
         nav_file() { }
-        nav_file(std::string_view nav_mesh_file);
+        nav_file(std::string_view nav_mesh_file, nav_area_order order = nav_area_order::file);
 
-        void load(std::string_view nav_mesh_file);
+        // the order applies to m_areas and everything indexed like it, which the searches walk constantly
+        void load(std::string_view nav_mesh_file, nav_area_order order = nav_area_order::file);
 
         std::optional< std::vector< vec3_t > > find_path(vec3_t from, vec3_t to);
         std::optional< std::vector< PathNode > > find_path_detailed(vec3_t from, vec3_t to);
-        float compute_path_length(std::vector< PathNode > path);
-        float compute_path_length_from_origin(vec3_t origin, std::vector< PathNode > path);
+        // native searches over the connection arrays. these never modify the nav_file, take their cost
+        // adjustments from the options instead of m_areas_to_increase_cost and are safe to run concurrently
+        std::optional< std::vector< vec3_t > > find_path(vec3_t from, vec3_t to, const nav_path_options_t& options) const;
+        std::optional< std::vector< PathNode > > find_path_detailed(vec3_t from, vec3_t to, const nav_path_options_t& options) const;
+        // same searches writing into caller owned buffers, which are cleared first. with reused buffers these
+        // don't allocate once everything has grown to its working size
+        // stats, if given, receives the cost, the proven quality bound and the work done
+        nav_path_status find_path(vec3_t from, vec3_t to, std::vector< vec3_t >& path, const nav_path_options_t& options = { },
+            nav_path_stats_t* stats = nullptr) const;
+        nav_path_status find_path_detailed(vec3_t from, vec3_t to, std::vector< PathNode >& path, const nav_path_options_t& options = { },
+            nav_path_stats_t* stats = nullptr) const;
+        // the same search spread over as many calls as it takes. begin only sets the handle up, every resume runs
+        // within the budget in the options of the handle and leaves the best path so far in path, which keeps
+        // ending short of the goal for as long as the status is partial
+        nav_path_status begin_path_search(vec3_t from, vec3_t to, nav_search_handle& handle, const nav_path_options_t& options = { }) const;
+        nav_path_status resume_path_search(nav_search_handle& handle, std::vector< vec3_t >& path) const;
+        nav_path_status resume_path_search(nav_search_handle& handle, std::vector< PathNode >& path) const;
+        // queues the search on the worker pool of the nav_file and returns right away. the path ends up in the future
+        // of the request, the callback is run on the worker first. the nav_file must not be reloaded while requests are out
+        nav_path_request find_path_async(vec3_t from, vec3_t to, const nav_path_options_t& options = { },
+            nav_request_priority priority = nav_request_priority::normal, nav_path_callback callback = { }) const;
+        // cost of the best path without building it or touching the path cache. length, if given, receives the
+        // length of the polyline from from through the middles of the crossed edges to to
+        std::optional< float > path_cost(vec3_t from, vec3_t to, const nav_path_options_t& options = { }, float* length = nullptr) const;
+        // costs from one start to many goals in a single search, costs[i] is FLT_MAX when to[i] can't be reached
+        void path_costs(vec3_t from, const std::vector< vec3_t >& to, std::vector< float >& costs, const nav_path_options_t& options = { }) const;
+        // every area reachable from the area nearest to from within max_cost, cheapest first. areas is cleared and
+        // refilled so it can be reused between calls, returns the number of areas found
+        std::size_t areas_within_cost(vec3_t from, float max_cost, std::vector< nav_area_cost_t >& areas,
+            const nav_path_options_t& options = { }) const;
+        // distance and next step towards the nearest of the goals for every area in one pass, costs above max_cost are cut off
+        void build_flow_field(const std::vector< std::uint32_t >& goal_area_ids, nav_flow_field& field,
+            const nav_path_options_t& options = { }, float max_cost = FLT_MAX) const;
+        // nearest hiding spot to position within max_distance that the area nearest to threat can't potentially see,
+        // having all of required_flags. nullptr if there is none
+        const nav_tactical_spot_t* get_nearest_hidden_spot(vec3_t position, vec3_t threat, float max_distance = FLT_MAX,
+            std::uint8_t required_flags = 0) const;
+        // indices into m_tactical.get_spots() of the spots encountered along the best path, each once in the order
+        // first seen. spots is cleared first, returns the status of the search
+        nav_path_status get_spots_along_path(vec3_t from, vec3_t to, std::vector< std::uint32_t >& spots,
+            const nav_path_options_t& options = { }) const;
+        // walks the segment from from to to in 2d across the shared edges of connected areas, starting on the area
+        // nearest to from. cheap check whether an agent can move straight to a point, costing O(areas crossed) and no
+        // allocations. the areas crossed go to areas, up to max_areas of them
+        nav_raycast_result_t raycast(vec3_t from, vec3_t to, std::uint32_t* areas = nullptr, std::size_t max_areas = 0) const;
+        nav_raycast_result_t raycast(std::size_t start_index, vec3_t from, vec3_t to, std::uint32_t* areas = nullptr,
+            std::size_t max_areas = 0) const;
+        float compute_path_length(const std::vector< PathNode >& path) const;
+        float compute_path_length(const PathNode* path, std::size_t count) const;
+        float compute_path_length_from_origin(vec3_t origin, const std::vector< PathNode >& path) const;
+        float compute_path_length_from_origin(vec3_t origin, const PathNode* path, std::size_t count) const;
 
         //MicroPather implementation
         virtual float LeastCostEstimate(void* start, void* end) {
@@ -83,9 +153,23 @@ namespace nav_mesh {
         const nav_area& get_area_by_id(void* id) const;
         // added by durst since now have a lookup map but don't want to remove old implementaiton
         const nav_area& get_area_by_id_fast(std::uint32_t id) const;
+        // dense index of the area in m_areas, the addressing used by connections and cost overlays
+        std::size_t get_area_index(std::uint32_t id) const;
+        std::size_t get_area_index(const nav_area& area) const { return static_cast<std::size_t>(&area - m_areas.data()); }
+        nav_cost_overlay make_cost_overlay() const { return nav_cost_overlay(m_areas.size()); }
+        // O(1) lookup in the potentially visible set of from, see m_visibility for bulk queries
+        bool is_potentially_visible(const nav_area& from, const nav_area& to) const {
+            return m_visibility.is_potentially_visible(get_area_index(from), get_area_index(to));
+        }
         // added by durst for maps that don't have places
         std::string get_place(std::uint16_t id) const;
         nav_area& get_area_by_position(vec3_t position);
+        // ground height under each of positions through m_area_grid, see nav_area_grid::get_ground_z. for snapping
+        // projectiles and replayed positions onto the mesh in bulk
+        std::size_t get_ground_z(const vec3_t* positions, std::size_t count, float* z, std::uint32_t* area_indices = nullptr,
+            float step_height = NAV_GROUND_STEP_HEIGHT) const {
+            return m_area_grid.get_ground_z(positions, count, z, area_indices, step_height);
+        }
         float get_point_to_area_distance(vec3_t position, const nav_area& area, float z_scaling = 1.) const;
         float get_point_to_area_distance_within(vec3_t position, const nav_area& area, float z_scaling = 1.) const;
         float get_point_to_area_distance_2d(vec3_t position, const nav_area& area) const;
@@ -93,23 +177,106 @@ namespace nav_mesh {
         const nav_area& get_nearest_area_by_position(vec3_t position) const;
         const nav_area& get_nearest_area_by_position_z_limit(vec3_t position, float z_below_limit, float z_above_limit) const;
         const nav_area& get_nearest_area_by_position_in_place(vec3_t position, std::uint16_t place_id) const;
+        // only snaps to areas that can both reach and be reached from the reference area
+        const nav_area& get_nearest_area_by_position_in_component(vec3_t position, std::uint32_t reference_area_id) const;
         std::vector<AreaDistance> get_area_distances_to_position(vec3_t position) const;
-        void remove_incoming_edges_to_areas(std::set<std::uint32_t> ids);
+        // only walk connections unless use_ladders is set, a ladder into an area keeps working when its floor is blocked
+        void remove_incoming_edges_to_areas(std::set<std::uint32_t> ids, bool use_ladders = false);
         void remove_edges(std::set<std::pair<std::uint32_t, std::uint32_t>> ids);
+        // undo the removals above, both only ever touch the areas involved. toggling doors and breakable walls
+        // this way costs O(degree) per connection and never rebuilds the connection arrays
+        void restore_incoming_edges_to_areas(std::set<std::uint32_t> ids);
+        void restore_edges(std::set<std::pair<std::uint32_t, std::uint32_t>> ids);
         void build_connections_arrays();
-        std::set<std::uint32_t> get_sources_to_area(std::uint32_t id) const;
+        // optional load stage merging small fragmented areas into the super nodes of m_coarse_graph, used by searches
+        // with use_coarse_graph set. connection edits don't need a rebuild, searches the coarse graph misleads fall
+        // back to the full search
+        void build_coarse_graph();
+        // permutes m_areas before anything indexed like it is built
+        void reorder_areas(nav_area_order order);
+        // removes a connection of area_index from the forward and reverse arrays and m_connections in place,
+        // in O(degree) without touching any other area. connection indexes into connections
+        void remove_connection(std::size_t area_index, std::size_t connection);
+        // moves a removed connection of area_index from the slack back into the slice, at its end
+        void restore_connection(std::size_t area_index, std::size_t connection);
+        // bumps m_graph_version and drops everything derived from the old connections
+        void on_connections_changed();
+        // end of the room of an area in connections or reverse_connections, its slice plus the removed entries after it
+        std::size_t get_connections_end(std::size_t area_index) const;
+        std::size_t get_reverse_connections_end(std::size_t area_index) const;
+        // index of the entry of a connection in reverse_connections
+        std::size_t find_reverse_connection(std::size_t connection) const;
+        nav_portal_t compute_portal(const nav_area& area, const nav_area& next_area) const;
+        // index into connections of the connection from area_index to next_index, NAV_INVALID_INDEX if there is none
+        std::size_t find_connection(std::size_t area_index, std::size_t next_index) const;
+        // areas that walk into the area, or climb into it as well with use_ladders
+        std::set<std::uint32_t> get_sources_to_area(std::uint32_t id, bool use_ladders = false) const;
+        // dense indexes of the areas with a connection into area_index, sorted. returns how many
+        std::size_t get_sources_to_area(std::size_t area_index, std::vector< std::uint32_t >& sources, bool use_ladders = false) const;
+        nav_path_cache_key_t get_path_cache_key(std::size_t start, std::size_t goal, const nav_path_options_t& options) const;
+        // search_path through the path cache when the options allow it. request_cancelled is polled next to
+        // options.cancelled, for the worker pool to abandon a search every request left
+        nav_path_status solve_path(nav_search_context& context, std::size_t start, std::size_t goal, const nav_path_options_t& options,
+            nav_path_stats_t* stats = nullptr, const std::atomic< bool >* request_cancelled = nullptr) const;
+        // entries of a file written by save_path_cache, with area ids mapped back to indices
+        bool read_path_cache_file(std::string_view file, std::vector< nav_path_cache_entry_t >& entries) const;
+        // leaves the path, or for a partial search the path to the most promising area, in context.m_path. bounded is
+        // cleared when the path was found inside a coarse corridor, whose cost has no bound against the optimal one
+        nav_path_status search_path(nav_search_context& context, std::size_t start, std::size_t goal, const nav_path_options_t& options,
+            bool& bounded, const std::atomic< bool >* request_cancelled = nullptr) const;
+        void continue_path_search(nav_search_handle& handle) const;
+        // turns context.m_path into the output asked for by the options
+        void build_path_output(nav_search_context& context, nav_path_status status, vec3_t from, vec3_t to,
+            const nav_path_options_t& options, std::vector< vec3_t >& path) const;
+        void build_path_output(nav_search_context& context, nav_path_status status, vec3_t from, vec3_t to,
+            const nav_path_options_t& options, std::vector< PathNode >& path) const;
+        // path_connections[i] is the connection into area_indices[i] as the search took it, without them the first
+        // connection between the areas is used
+        void build_path_points(const std::uint32_t* area_indices, std::size_t count, vec3_t to, std::vector< vec3_t >& path,
+            const std::uint32_t* path_connections = nullptr) const;
+        void build_path_nodes(const std::uint32_t* area_indices, std::size_t count, vec3_t to, std::vector< PathNode >& path,
+            const std::uint32_t* path_connections = nullptr) const;
+        // the connections a search with options would take along a path that didn't come out of one, like a cached path
+        // or a corridor. the first entry and areas that aren't connected (anymore) get NAV_INVALID_INDEX
+        void find_path_connections(const std::uint32_t* area_indices, std::size_t count, const nav_path_options_t& options,
+            std::vector< std::uint32_t >& path_connections) const;
+        // string pulls context.m_path from from to to, leaving the corners in context.m_corners
+        void straighten_path(nav_search_context& context, vec3_t from, vec3_t to) const;
+        // length of from, the shared edge middles along the parent links of the last search, to
+        float get_portal_path_length(const nav_search_context& context, std::size_t start, std::size_t goal, vec3_t from, vec3_t to) const;
+        // writes up to max_entries of the most used cached paths, tagged with the hash of the loaded map. only solved
+        // paths on the connections as loaded are written, edits and overlay versions don't survive a restart
+        void save_path_cache(std::string_view file, std::size_t max_entries = 4096) const;
+        // restores paths saved for the same map, returns how many. a missing file or another map restores nothing
+        std::size_t load_path_cache(std::string_view file);
+        // re-solves the saved start and goal pairs that were found with the same options, most used first, on a
+        // background thread. the options are copied but an overlay must outlive the returned future, which yields the
+        // number of pairs solved. a later call, load and the destructor stop the thread
+        std::future< std::size_t > warm_path_cache(std::string_view file, const nav_path_options_t& options = { },
+            std::size_t max_pairs = 4096) const;
         void set_areas_to_increase_cost(std::set<uint32_t> new_areas) {
             m_areas_to_increase_cost = new_areas;
             m_pather->Reset();
         }
 
         std::unique_ptr< micropather::MicroPather > m_pather = nullptr;
+        // shared by every native search, keyed on the options so differently configured queries never collide
+        std::unique_ptr< nav_path_cache > m_path_cache = nullptr;
+        // scratch for the MicroPather based find_path flavours
+        micropather::MPVector< void* > m_path_area_ids = { };
+        std::vector< std::uint32_t > m_path_area_indices = { };
 
         std::uint8_t m_is_analyzed = 0,
             m_has_unnamed_areas = 0;
 
         std::uint16_t m_place_count = 0;
 
+        std::uint64_t m_map_hash = 0;
+        // changes on every load and whenever connections are removed or restored, for anything caching results
+        std::uint64_t m_graph_version = 0;
+        // m_graph_version of the connections as loaded from the file, before any edit
+        std::uint64_t m_loaded_graph_version = 0;
+
         std::uint32_t m_magic = 0xFEEDFACE,
             m_version = 0,
             m_sub_version = 0,
@@ -119,9 +286,37 @@ namespace nav_mesh {
         nav_buffer m_buffer = { };
         std::vector< nav_area > m_areas = { };
         std::vector< std::string > m_places = { };
+        std::vector< nav_ladder_t > m_ladders = { };
         std::map< uint32_t, size_t > m_area_ids_to_indices;
         std::map< void*, size_t > m_area_ptr_ids_to_indices;
         std::vector<size_t> connections; // store connections as a contiguous array of array indexes rather than area ids
+        // removals shrink the length of an area in place and keep the removed connections in the slack up to the
+        // start of the next area, in both the forward and the reverse arrays, which is where restoring finds them
         std::vector<size_t> connections_area_start, connections_area_length;
+        // shared edge of every connection, parallel to connections
+        std::vector< nav_portal_t > connections_portals;
+        // width of the shared edge of every connection, parallel to connections and kept apart from the portals
+        // so the width check in the search loops touches 4 bytes per connection
+        std::vector< float > connections_clearance;
+        // both parallel to connections. ladder connections follow the walking ones in the slice of their area, also
+        // after removals and restores. the extra cost is what the way over the ladder adds to the center to center
+        // distance, 0 for walking
+        std::vector< nav_connection_kind > connections_kind;
+        std::vector< float > connections_extra_cost;
+        // the same connections grouped by target area, reverse_connections holds source indexes and
+        // reverse_connections_edge the index of the connection in connections
+        std::vector<size_t> reverse_connections, reverse_connections_edge;
+        std::vector<size_t> reverse_connections_area_start, reverse_connections_area_length;
+        // hot per area data for the native searches, indexed like m_areas
+        std::vector< vec3_t > m_area_centers;
+        std::vector< std::uint32_t > m_area_attributes;
+        nav_components m_components;
+        nav_area_grid m_area_grid;
+        nav_coarse_graph m_coarse_graph;
+        nav_visibility m_visibility;
+        nav_tactical m_tactical;
+        // last so their threads are stopped before anything they read is destroyed
+        std::unique_ptr< nav_path_workers > m_path_workers = nullptr;
+        std::unique_ptr< nav_path_cache_warm_up > m_path_cache_warm_up = nullptr;
     };
 }
\ No newline at end of file
@@ -3,10 +3,21 @@
 #include "nav_structs.h"
 
 namespace nav_mesh {
+	enum nav_hiding_spot_flags : std::uint8_t {
+		NAV_HIDING_SPOT_IN_COVER = 0x01,
+		NAV_HIDING_SPOT_GOOD_SNIPER_SPOT = 0x02,
+		NAV_HIDING_SPOT_IDEAL_SNIPER_SPOT = 0x04,
+		NAV_HIDING_SPOT_EXPOSED = 0x08
+	};
+
 	class nav_hiding_spot {
 	public:
 		nav_hiding_spot(nav_buffer& buffer);
 
+		std::uint32_t get_id() const { return m_id; }
+		vec3_t get_pos() const { return m_pos; }
+		std::uint8_t get_flags() const { return m_flags; }
+
 	private:
 		void load(nav_buffer& buffer);
 
@@ -0,0 +1,195 @@
+#include "nav_path_cache.h"
+#include <algorithm>
+
+namespace nav_mesh {
+    nav_path_cache::nav_path_cache(std::size_t byte_budget, std::size_t shard_count)
+        : m_shard_count(shard_count ? shard_count : 1), m_byte_budget(byte_budget),
+        m_shards(std::make_unique< shard_t[] >(m_shard_count)) { }
+
+    std::size_t nav_path_cache_key_hash_t::operator()(const nav_path_cache_key_t& key) const {
+        std::uint64_t h = 14695981039346656037ULL;
+        auto mix = [&](std::uint64_t value) {
+            h ^= value;
+            h *= 1099511628211ULL;
+        };
+
+        mix(key.start);
+        mix(key.goal);
+        mix(key.overlay_version);
+        mix(key.graph_version);
+        mix(key.options_tag);
+
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+    std::size_t nav_path_cache::get_entry_bytes(std::size_t path_count) {
+        // entry, index node and the sequence itself
+        return sizeof(entry_t) + sizeof(nav_path_cache_key_t) + 4 * sizeof(void*) + path_count * sizeof(std::uint32_t);
+    }
+
+    bool nav_path_cache::find(const nav_path_cache_key_t& key, std::vector< std::uint32_t >& path, float& cost) {
+        shard_t& shard = get_shard(key);
+        std::lock_guard< std::mutex > lock(shard.mutex);
+
+        auto found = shard.index.find(key);
+        if (found == shard.index.end()) {
+            m_misses++;
+            return false;
+        }
+
+        entry_t& entry = shard.entries[found->second];
+        entry.referenced = true;
+        entry.hits++;
+        path.assign(entry.path.begin(), entry.path.end());
+        cost = entry.cost;
+
+        m_hits++;
+        return true;
+    }
+
+    void nav_path_cache::insert(const nav_path_cache_key_t& key, const std::uint32_t* path, std::size_t count, float cost, std::uint32_t hits) {
+        std::size_t entry_bytes = get_entry_bytes(count);
+        if (entry_bytes > m_byte_budget / m_shard_count)
+            return;
+
+        shard_t& shard = get_shard(key);
+        std::lock_guard< std::mutex > lock(shard.mutex);
+
+        if (shard.index.find(key) != shard.index.end())
+            return;
+
+        evict(shard, entry_bytes);
+
+        std::size_t slot;
+        if (!shard.free_entries.empty()) {
+            slot = shard.free_entries.back();
+            shard.free_entries.pop_back();
+        }
+        else {
+            slot = shard.entries.size();
+            shard.entries.emplace_back();
+        }
+
+        entry_t& entry = shard.entries[slot];
+        entry.key = key;
+        entry.path.assign(path, path + count);
+        entry.cost = cost;
+        entry.hits = hits;
+        entry.referenced = false;
+        entry.used = true;
+
+        shard.index.insert({ key, slot });
+        shard.bytes += entry_bytes;
+        m_insertions++;
+    }
+
+    void nav_path_cache::evict(shard_t& shard, std::size_t needed_bytes) {
+        std::size_t shard_budget = m_byte_budget / m_shard_count;
+
+        while (shard.bytes + needed_bytes > shard_budget && !shard.index.empty()) {
+            if (shard.hand >= shard.entries.size())
+                shard.hand = 0;
+
+            entry_t& entry = shard.entries[shard.hand];
+            if (entry.used) {
+                // second chance for anything hit since the hand last passed
+                if (entry.referenced) {
+                    entry.referenced = false;
+                }
+                else {
+                    shard.bytes -= get_entry_bytes(entry.path.size());
+                    shard.index.erase(entry.key);
+                    shard.free_entries.push_back(shard.hand);
+                    entry.used = false;
+                    entry.path = { };
+                    m_evictions++;
+                }
+            }
+
+            shard.hand++;
+        }
+    }
+
+    void nav_path_cache::get_hottest(std::size_t max_entries, std::vector< nav_path_cache_entry_t >& entries) const {
+        entries.clear();
+
+        for (std::size_t i = 0; i < m_shard_count; i++) {
+            shard_t& shard = m_shards[i];
+            std::lock_guard< std::mutex > lock(shard.mutex);
+
+            for (const entry_t& entry : shard.entries) {
+                if (entry.used)
+                    entries.push_back({ entry.key, entry.path, entry.cost, entry.hits });
+            }
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const nav_path_cache_entry_t& a, const nav_path_cache_entry_t& b) {
+            return a.hits > b.hits;
+            });
+
+        if (entries.size() > max_entries)
+            entries.resize(max_entries);
+    }
+
+    void nav_path_cache::clear() {
+        for (std::size_t i = 0; i < m_shard_count; i++) {
+            shard_t& shard = m_shards[i];
+            std::lock_guard< std::mutex > lock(shard.mutex);
+
+            shard.index.clear();
+            shard.entries.clear();
+            shard.free_entries.clear();
+            shard.hand = shard.bytes = 0;
+        }
+    }
+
+    void nav_path_cache::set_byte_budget(std::size_t byte_budget) {
+        m_byte_budget = byte_budget;
+
+        for (std::size_t i = 0; i < m_shard_count; i++) {
+            std::lock_guard< std::mutex > lock(m_shards[i].mutex);
+            evict(m_shards[i], 0);
+        }
+    }
+
+    nav_path_cache_stats_t nav_path_cache::get_stats() const {
+        nav_path_cache_stats_t stats;
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        stats.insertions = m_insertions;
+        stats.evictions = m_evictions;
+
+        for (std::size_t i = 0; i < m_shard_count; i++) {
+            shard_t& shard = m_shards[i];
+            std::lock_guard< std::mutex > lock(shard.mutex);
+
+            stats.entries += shard.index.size();
+            stats.bytes += shard.bytes;
+        }
+
+        return stats;
+    }
+
+    nav_path_cache_warm_up::~nav_path_cache_warm_up() {
+        stop();
+    }
+
+    std::future< std::size_t > nav_path_cache_warm_up::start(std::function< std::size_t(const std::atomic< bool >&) > work) {
+        stop();
+        m_cancelled = false;
+
+        std::packaged_task< std::size_t() > task([this, work = std::move(work)]() { return work(m_cancelled); });
+        std::future< std::size_t > result = task.get_future();
+        m_thread = std::thread(std::move(task));
+
+        return result;
+    }
+
+    void nav_path_cache_warm_up::stop() {
+        if (!m_thread.joinable())
+            return;
+
+        m_cancelled = true;
+        m_thread.join();
+    }
+}
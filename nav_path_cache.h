@@ -0,0 +1,129 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace nav_mesh {
+    struct nav_path_cache_key_t {
+        // dense area indices
+        std::uint32_t start = 0,
+            goal = 0;
+
+        // nav_cost_overlay::get_version of the overlay used, 0 without one
+        std::uint64_t overlay_version = 0;
+        // nav_file::m_graph_version when the search ran, so paths from before an edit never match after it
+        std::uint64_t graph_version = 0;
+        // fingerprint of every other option that changes which path is found
+        std::uint64_t options_tag = 0;
+
+        bool operator==(const nav_path_cache_key_t& other) const {
+            return start == other.start && goal == other.goal &&
+                overlay_version == other.overlay_version && graph_version == other.graph_version &&
+                options_tag == other.options_tag;
+        }
+    };
+
+    struct nav_path_cache_key_hash_t {
+        std::size_t operator()(const nav_path_cache_key_t& key) const;
+    };
+
+    struct nav_path_cache_stats_t {
+        std::uint64_t hits = 0,
+            misses = 0,
+            insertions = 0,
+            evictions = 0;
+
+        std::size_t entries = 0,
+            bytes = 0;
+    };
+
+    struct nav_path_cache_entry_t {
+        nav_path_cache_key_t key = { };
+        std::vector< std::uint32_t > path = { };
+        float cost = 0.f;
+        std::uint32_t hits = 0;
+    };
+
+    /*
+     *	Thread safe cache of solved area sequences. Keys are spread over independently locked shards,
+     *	and each shard evicts with the CLOCK algorithm once it goes over its share of the byte budget.
+     *	Unsolvable queries are cached too, as empty paths with a cost of FLT_MAX.
+     */
+    class nav_path_cache {
+    public:
+        nav_path_cache(std::size_t byte_budget = 4 * 1024 * 1024, std::size_t shard_count = 16);
+
+        // copies the cached sequence into path on a hit
+        bool find(const nav_path_cache_key_t& key, std::vector< std::uint32_t >& path, float& cost);
+        void insert(const nav_path_cache_key_t& key, const std::uint32_t* path, std::size_t count, float cost, std::uint32_t hits = 0);
+        // copies out up to max_entries entries, most hit first
+        void get_hottest(std::size_t max_entries, std::vector< nav_path_cache_entry_t >& entries) const;
+        void clear();
+
+        void set_byte_budget(std::size_t byte_budget);
+        std::size_t get_byte_budget() const { return m_byte_budget; }
+
+        nav_path_cache_stats_t get_stats() const;
+
+    private:
+        struct entry_t {
+            nav_path_cache_key_t key = { };
+            std::vector< std::uint32_t > path = { };
+            float cost = 0.f;
+            std::uint32_t hits = 0;
+            // CLOCK reference bit, set on every hit
+            bool referenced = false;
+            bool used = false;
+        };
+
+        struct shard_t {
+            std::mutex mutex;
+            std::unordered_map< nav_path_cache_key_t, std::size_t, nav_path_cache_key_hash_t > index;
+            std::vector< entry_t > entries;
+            std::vector< std::size_t > free_entries;
+            std::size_t hand = 0,
+                bytes = 0;
+        };
+
+        shard_t& get_shard(const nav_path_cache_key_t& key) { return m_shards[nav_path_cache_key_hash_t()(key) % m_shard_count]; }
+        static std::size_t get_entry_bytes(std::size_t path_count);
+        // drops CLOCK victims until needed_bytes fit into the shard's share of the budget
+        void evict(shard_t& shard, std::size_t needed_bytes);
+
+        std::size_t m_shard_count;
+        std::atomic< std::size_t > m_byte_budget;
+        std::unique_ptr< shard_t[] > m_shards;
+
+        std::atomic< std::uint64_t > m_hits = { 0 },
+            m_misses = { 0 },
+            m_insertions = { 0 },
+            m_evictions = { 0 };
+    };
+
+    /*
+     *	Background thread of nav_file::warm_path_cache. Starting another run or destroying it sets the
+     *	cancel flag handed to the running work and joins it, so the work never outlives its owner.
+     */
+    class nav_path_cache_warm_up {
+    public:
+        nav_path_cache_warm_up() = default;
+        ~nav_path_cache_warm_up();
+
+        nav_path_cache_warm_up(const nav_path_cache_warm_up&) = delete;
+        nav_path_cache_warm_up& operator=(const nav_path_cache_warm_up&) = delete;
+
+        // stops the previous run, then runs work on a new thread. work should return soon after the flag is set
+        std::future< std::size_t > start(std::function< std::size_t(const std::atomic< bool >&) > work);
+        void stop();
+
+    private:
+        std::thread m_thread = { };
+        std::atomic< bool > m_cancelled = { false };
+    };
+}
@@ -0,0 +1,161 @@
+#include "nav_query.h"
+#include <atomic>
+#include <stdexcept>
+
+namespace nav_mesh {
+    void nav_cost_overlay::resize(std::size_t area_count) {
+        m_blocked.assign((area_count + 63) / 64, 0);
+        m_penalties.assign(area_count, 0.f);
+        touch();
+    }
+
+    void nav_cost_overlay::clear() {
+        std::fill(m_blocked.begin(), m_blocked.end(), 0);
+        std::fill(m_penalties.begin(), m_penalties.end(), 0.f);
+        touch();
+    }
+
+    void nav_cost_overlay::touch() {
+        static std::atomic< std::uint64_t > last_version = { 0 };
+        m_version = ++last_version;
+    }
+
+    void nav_cost_overlay::set_blocked(std::size_t area_index, bool blocked) {
+        std::uint64_t bit = std::uint64_t(1) << (area_index & 63);
+
+        if (blocked)
+            m_blocked[area_index >> 6] |= bit;
+        else
+            m_blocked[area_index >> 6] &= ~bit;
+
+        touch();
+    }
+
+    void nav_cost_overlay::set_penalty(std::size_t area_index, float penalty) {
+        if (!(penalty >= 0.f))
+            throw std::runtime_error("nav_cost_overlay::set_penalty: negative penalty");
+
+        m_penalties[area_index] = penalty;
+        touch();
+    }
+
+    void nav_cost_overlay::avoid(NavAttributeType attribute, float penalty) {
+        if (!(penalty >= 0.f))
+            throw std::runtime_error("nav_cost_overlay::avoid: negative penalty");
+
+        m_avoided_attributes |= static_cast<std::uint32_t>(attribute);
+        m_avoid_penalty = penalty;
+        touch();
+    }
+
+    nav_search_context& get_thread_search_context() {
+        thread_local nav_search_context context;
+        return context;
+    }
+
+    void nav_flow_field::resize(std::size_t area_count) {
+        std::size_t padded_count = (area_count + NAV_FLOW_FIELD_PADDING - 1) / NAV_FLOW_FIELD_PADDING * NAV_FLOW_FIELD_PADDING;
+
+        m_distance.assign(padded_count, FLT_MAX);
+        m_next.assign(padded_count, NAV_INVALID_INDEX);
+    }
+
+    namespace {
+        // twice the signed area of abc, positive when c is left of (counter clockwise from) a to b
+        float triangle_area_2d(vec3_t a, vec3_t b, vec3_t c) {
+            return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        }
+
+        bool same_point_2d(vec3_t a, vec3_t b) {
+            float dx = a.x - b.x, dy = a.y - b.y;
+            return dx * dx + dy * dy < 1e-6f;
+        }
+    }
+
+    void nav_string_pull(vec3_t start, vec3_t end, const nav_portal_t* portals, std::size_t count,
+        std::vector< nav_path_corner_t >& corners) {
+        // portal i is portals[i - 1], with a zero width portal at the start and one at the end
+        auto get_left = [&](std::size_t i) { return i == 0 ? start : i > count ? end : portals[i - 1].left; };
+        auto get_right = [&](std::size_t i) { return i == 0 ? start : i > count ? end : portals[i - 1].right; };
+
+        vec3_t apex = start, left = start, right = start;
+        std::size_t apex_index = 0, left_index = 0, right_index = 0;
+
+        for (std::size_t i = 1; i <= count + 1; i++) {
+            vec3_t next_left = get_left(i), next_right = get_right(i);
+
+            // tighten the right side, unless it crosses the left side which then becomes a corner
+            if (triangle_area_2d(apex, right, next_right) >= 0.f) {
+                if (same_point_2d(apex, right) || triangle_area_2d(apex, left, next_right) < 0.f) {
+                    right = next_right;
+                    right_index = i;
+                }
+                else {
+                    corners.push_back({ left, static_cast<std::uint32_t>(left_index - 1) });
+                    apex = right = left;
+                    apex_index = right_index = left_index;
+                    i = apex_index;
+                    continue;
+                }
+            }
+
+            // same for the left side
+            if (triangle_area_2d(apex, left, next_left) <= 0.f) {
+                if (same_point_2d(apex, left) || triangle_area_2d(apex, right, next_left) > 0.f) {
+                    left = next_left;
+                    left_index = i;
+                }
+                else {
+                    corners.push_back({ right, static_cast<std::uint32_t>(right_index - 1) });
+                    apex = left = right;
+                    apex_index = left_index = right_index;
+                    i = apex_index;
+                    continue;
+                }
+            }
+        }
+
+        if (corners.empty() || !same_point_2d(corners.back().pos, end))
+            corners.push_back({ end, static_cast<std::uint32_t>(count) });
+        else
+            corners.back() = { end, static_cast<std::uint32_t>(count) };
+    }
+
+    void nav_search_context::begin(std::size_t area_count) {
+        if (m_reached.size() < area_count) {
+            m_reached.resize(area_count, 0);
+            m_closed.resize(area_count, 0);
+            m_parent.resize(area_count, 0);
+            m_parent_connection.resize(area_count, NAV_INVALID_INDEX);
+            m_cost.resize(area_count, FLT_MAX);
+        }
+
+        // on wrap around old stamps could alias the new generation, so pay for one real clear
+        if (++m_generation == 0) {
+            std::fill(m_reached.begin(), m_reached.end(), 0);
+            std::fill(m_closed.begin(), m_closed.end(), 0);
+            m_generation = 1;
+        }
+
+        m_open.clear();
+        m_path.clear();
+        m_path_connections.clear();
+        m_best_estimate = FLT_MAX;
+        m_expansions = 0;
+    }
+
+    void nav_search_context::build_path(std::size_t start, std::size_t goal) {
+        m_path.clear();
+        m_path_connections.clear();
+
+        for (std::size_t area_index = goal; area_index != start; area_index = m_parent[area_index]) {
+            m_path.push_back(static_cast<std::uint32_t>(area_index));
+            m_path_connections.push_back(m_parent_connection[area_index]);
+        }
+
+        m_path.push_back(static_cast<std::uint32_t>(start));
+        m_path_connections.push_back(NAV_INVALID_INDEX);
+        std::reverse(m_path.begin(), m_path.end());
+        std::reverse(m_path_connections.begin(), m_path_connections.end());
+    }
+}
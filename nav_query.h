@@ -0,0 +1,323 @@
+#pragma once
+#include "nav_area.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+
+namespace nav_mesh {
+    /*
+     *	Query scoped cost adjustments. An overlay never touches the nav_file it is used with,
+     *	so any number of overlays can be used concurrently against the same loaded mesh.
+     *	Areas are addressed by dense index (see nav_file::get_area_index), and the overlay
+     *	must be sized to the area count of the mesh before use.
+     */
+    class nav_cost_overlay {
+    public:
+        nav_cost_overlay() { }
+        nav_cost_overlay(std::size_t area_count) { resize(area_count); }
+
+        void resize(std::size_t area_count);
+        // unblocks every area and drops all penalties, attribute masks are left alone
+        void clear();
+        std::size_t size() const { return m_penalties.size(); }
+
+        void set_blocked(std::size_t area_index, bool blocked = true);
+        bool is_blocked(std::size_t area_index) const {
+            return (m_blocked[area_index >> 6] >> (area_index & 63)) & 1;
+        }
+
+        // penalties must not be negative, or the distance estimate of the searches overestimates
+        void set_penalty(std::size_t area_index, float penalty);
+        float get_penalty(std::size_t area_index) const { return m_penalties[area_index]; }
+
+        // areas with any of the forbidden attributes are never entered
+        void forbid(NavAttributeType attribute) {
+            m_forbidden_attributes |= static_cast<std::uint32_t>(attribute);
+            touch();
+        }
+        // areas with any of the avoided attributes cost m_avoid_penalty extra to enter, which must not be negative
+        void avoid(NavAttributeType attribute, float penalty);
+
+        // changes on every modification and is unique across all overlays, so it can key cached results
+        std::uint64_t get_version() const { return m_version; }
+
+        bool allows(std::size_t area_index, std::uint32_t attributes) const {
+            return (attributes & m_forbidden_attributes) == 0 && !is_blocked(area_index);
+        }
+
+        // extra cost of entering the area, on top of the distance between centers
+        float get_entry_cost(std::size_t area_index, std::uint32_t attributes) const {
+            return m_penalties[area_index] + ((attributes & m_avoided_attributes) ? m_avoid_penalty : 0.f);
+        }
+
+        std::uint32_t m_forbidden_attributes = 0,
+            m_avoided_attributes = 0;
+
+        float m_avoid_penalty = 0.f;
+
+    private:
+        void touch();
+
+        std::uint64_t m_version = 0;
+        std::vector< std::uint64_t > m_blocked = { };
+        std::vector< float > m_penalties = { };
+    };
+
+    enum class nav_cost_profile : std::uint8_t {
+        // center to center distance
+        distance,
+        // distance scaled by attribute_weights of the entered area
+        attribute_weighted,
+        // seconds of travel using the movement speeds below
+        time
+    };
+
+    enum class nav_path_status : std::uint8_t {
+        solved,
+        no_solution,
+        start_end_same,
+        // the search ran out of budget, the path leads to the most promising area reached so far
+        partial
+    };
+
+    enum class nav_path_output : std::uint8_t {
+        // area centers joined by the middles of the shared edges
+        area_centers,
+        // only the corners where the path has to turn, pulled tight through the shared edges
+        straightened
+    };
+
+    enum class nav_connection_kind : std::uint8_t {
+        // across a shared edge, from the connections of the areas
+        walk,
+        // climbing a ladder, from the ladder records of the nav file
+        ladder_up,
+        ladder_down
+    };
+
+    struct nav_attribute_weight_t {
+        std::uint32_t attributes = 0;
+        // must be at least 1 so the distance estimate stays admissible, searches throw otherwise
+        float scale = 1.f;
+    };
+
+    constexpr std::size_t NAV_ATTRIBUTE_WEIGHT_COUNT = 4;
+
+    // width a player needs to fit through a shared edge, a good min_width for player sized agents
+    constexpr float NAV_PLAYER_WIDTH = 32.f;
+
+    struct nav_path_options_t {
+        nav_cost_profile profile = nav_cost_profile::distance;
+        nav_path_output output = nav_path_output::area_centers;
+
+        // optional, not owned. must outlive the call it is passed to
+        const nav_cost_overlay* overlay = nullptr;
+
+        nav_attribute_weight_t attribute_weights[NAV_ATTRIBUTE_WEIGHT_COUNT] = { };
+
+        // look solved area sequences up in, and add them to, the path cache of the nav_file
+        bool use_path_cache = true;
+        // restrict one shot searches to the areas of the node path through nav_file::m_coarse_graph, once it is
+        // built. far fewer expansions for a path that may be a little longer than the best one, by no proven bound
+        bool use_coarse_graph = false;
+
+        // connections whose shared edge is narrower than this are never taken, see nav_file::connections_clearance
+        float min_width = 0.f;
+        // take ladder connections as well. ladders are climbed at walk speed in the time profile
+        bool use_ladders = false;
+
+        // for the time profile, all above 0 and none faster than run_speed
+        float run_speed = 250.f,
+            walk_speed = 130.f,
+            crouch_speed = 85.f;
+
+        // search budget, a search that hits either limit returns nav_path_status::partial. 0 expansions is no limit,
+        // the deadline is only checked every NAV_DEADLINE_CHECK_INTERVAL expansions
+        std::uint32_t max_expansions = 0;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        // optional, not owned. the search gives up as partial soon after this is set, polled like the deadline
+        const std::atomic< bool >* cancelled = nullptr;
+
+        // weighted A*, orders the open list by cost + heuristic_weight * estimate. anything above 1 expands
+        // fewer areas for a path that costs at most heuristic_weight times the optimal one
+        float heuristic_weight = 1.f;
+    };
+
+    constexpr std::uint32_t NAV_DEADLINE_CHECK_INTERVAL = 32;
+
+    struct nav_path_stats_t {
+        // in units of the cost profile, for a partial path the cost up to where it ends. FLT_MAX without a path
+        float cost = FLT_MAX;
+        // the found cost is proven to be at most this many times the optimal one. FLT_MAX for partial paths and
+        // for paths of a use_coarse_graph search, which only looked inside the coarse corridor
+        float suboptimality_bound = 1.f;
+        // areas expanded, 0 when the path came out of the path cache
+        std::size_t expansions = 0;
+        bool from_cache = false;
+    };
+
+    constexpr std::uint32_t NAV_INVALID_INDEX = 0xFFFFFFFF;
+
+    struct nav_raycast_result_t {
+        // the segment leaves the mesh before reaching its end
+        bool hit = false;
+        // fraction of the segment walked before leaving the mesh, 1 without a hit
+        float t = 1.f;
+        // where the segment leaves the mesh, on the ground of the last area. the end of the segment without a hit
+        vec3_t position = { };
+        // last area the segment is on
+        std::uint32_t area_index = NAV_INVALID_INDEX;
+        // areas crossed from the start on, including the last one. can be more than the buffer held
+        std::size_t area_count = 0;
+    };
+
+    struct nav_area_cost_t {
+        std::uint32_t area_index;
+        float cost;
+    };
+
+    /*
+     *	Result of nav_file::build_flow_field, indexed like m_areas. Both arrays are padded to a
+     *	multiple of NAV_FLOW_FIELD_PADDING entries so they can be processed in full SIMD lanes,
+     *	padding entries are unreachable.
+     */
+    constexpr std::size_t NAV_FLOW_FIELD_PADDING = 8;
+
+    class nav_flow_field {
+    public:
+        void resize(std::size_t area_count);
+
+        bool is_reachable(std::size_t area_index) const { return m_distance[area_index] < FLT_MAX; }
+        // cost from the area to the nearest goal, FLT_MAX if unreachable or beyond the cutoff
+        float get_distance(std::size_t area_index) const { return m_distance[area_index]; }
+        // area to move into next, NAV_INVALID_INDEX for goals and unreachable areas
+        std::uint32_t get_next(std::size_t area_index) const { return m_next[area_index]; }
+
+        std::vector< float > m_distance = { };
+        std::vector< std::uint32_t > m_next = { };
+        // goal indices of the last build, kept to avoid reallocating
+        std::vector< std::uint32_t > m_goals = { };
+    };
+
+    struct nav_path_corner_t {
+        vec3_t pos;
+        // portal the corner lies on, the portal count for the end point
+        std::uint32_t portal;
+    };
+
+    /*
+     *	Simple stupid funnel: string pulls from start to end through a sequence of portals and
+     *	appends the minimal set of turning points to corners, ending with end itself.
+     */
+    void nav_string_pull(vec3_t start, vec3_t end, const nav_portal_t* portals, std::size_t count,
+        std::vector< nav_path_corner_t >& corners);
+
+    struct nav_open_entry_t {
+        float priority;
+        std::uint32_t index;
+
+        bool operator>(const nav_open_entry_t& other) const { return priority > other.priority; }
+    };
+
+    /*
+     *	Scratch state for the native searches over the CSR arrays of nav_file. Per area state is
+     *	stamped with a generation instead of being cleared, so beginning a search is O(1) and a
+     *	reused context performs no allocations once it has grown to the size of the mesh.
+     *	A context must only be used by one search at a time.
+     */
+    class nav_search_context {
+    public:
+        void begin(std::size_t area_count);
+
+        bool is_reached(std::size_t area_index) const { return m_reached[area_index] == m_generation; }
+        bool is_closed(std::size_t area_index) const { return m_closed[area_index] == m_generation; }
+        float get_cost(std::size_t area_index) const { return is_reached(area_index) ? m_cost[area_index] : FLT_MAX; }
+        std::uint32_t get_parent(std::size_t area_index) const { return m_parent[area_index]; }
+        // the connection from the parent the search took, there can be a walk and a ladder one between the same areas
+        std::uint32_t get_parent_connection(std::size_t area_index) const { return m_parent_connection[area_index]; }
+
+        void reach(std::size_t area_index, float cost, std::size_t parent, std::size_t connection = NAV_INVALID_INDEX) {
+            m_reached[area_index] = m_generation;
+            m_cost[area_index] = cost;
+            m_parent[area_index] = static_cast<std::uint32_t>(parent);
+            m_parent_connection[area_index] = static_cast<std::uint32_t>(connection);
+        }
+
+        void close(std::size_t area_index) { m_closed[area_index] = m_generation; }
+
+        bool has_open() const { return !m_open.empty(); }
+
+        void push(float priority, std::size_t area_index) {
+            m_open.push_back({ priority, static_cast<std::uint32_t>(area_index) });
+            std::push_heap(m_open.begin(), m_open.end(), std::greater< nav_open_entry_t >());
+        }
+
+        nav_open_entry_t pop() {
+            std::pop_heap(m_open.begin(), m_open.end(), std::greater< nav_open_entry_t >());
+            nav_open_entry_t entry = m_open.back();
+            m_open.pop_back();
+            return entry;
+        }
+
+        // walks the parent links back from the goal, leaving start..goal in m_path and the connections taken in m_path_connections
+        void build_path(std::size_t start, std::size_t goal);
+
+        std::vector< std::uint32_t > m_path = { };
+        // connection into each area of m_path, NAV_INVALID_INDEX for the start
+        std::vector< std::uint32_t > m_path_connections = { };
+        // goal areas of a batched search
+        std::vector< std::uint32_t > m_goals = { };
+        // scratch for straightening m_path
+        std::vector< nav_portal_t > m_portals = { };
+        std::vector< nav_path_corner_t > m_corners = { };
+
+        // closed area with the lowest estimate left to the goal, where a partial path ends
+        std::uint32_t m_best = 0;
+        float m_best_estimate = FLT_MAX;
+        float m_heuristic_weight = 1.f;
+        // areas expanded since begin
+        std::size_t m_expansions = 0;
+
+    private:
+        std::uint32_t m_generation = 0;
+
+        std::vector< std::uint32_t > m_reached = { },
+            m_closed = { },
+            m_parent = { },
+            m_parent_connection = { };
+
+        std::vector< float > m_cost = { };
+        std::vector< nav_open_entry_t > m_open = { };
+    };
+
+    // one context per thread so concurrent const queries never share scratch state
+    nav_search_context& get_thread_search_context();
+
+    /*
+     *	A path search spread over several calls, see nav_file::begin_path_search. The handle owns
+     *	its own search state, so any number of handles can be in flight at once and each one
+     *	continues exactly where the previous call stopped. The budget of every call is taken from
+     *	m_options, which may be changed between calls to set a new deadline.
+     */
+    class nav_search_handle {
+    public:
+        nav_path_status get_status() const { return m_status; }
+        bool is_done() const { return m_status != nav_path_status::partial; }
+
+        // an overlay in here must outlive the search
+        nav_path_options_t m_options = { };
+
+        vec3_t m_from = { },
+            m_to = { };
+
+        std::size_t m_start = 0,
+            m_goal = 0;
+
+        nav_path_status m_status = nav_path_status::no_solution;
+        nav_search_context m_context = { };
+    };
+}
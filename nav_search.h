@@ -0,0 +1,463 @@
+#pragma once
+#include "nav_file.h"
+#include <stdexcept>
+
+/*
+ *	Native searches over the CSR connection arrays of nav_file.
+ *
+ *	The search loops are templated on a cost policy so every profile gets its own loop with the
+ *	cost function inlined, instead of going through Graph::AdjacentCost and a void* lookup per
+ *	neighbor like MicroPather does. A cost policy provides:
+ *		bool allows(std::size_t area_index) const
+ *		bool allows_connection(std::size_t connection) const
+ *		float get_step_cost(std::size_t from, std::size_t to) const
+ *		float get_connection_cost(std::size_t connection) const
+ *		float get_estimate(std::size_t from, std::size_t goal) const
+ *	A step through connection i costs get_step_cost plus get_connection_cost(i), which is where
+ *	ladders add their climb. get_estimate must never overestimate the step costs summed along a path. Weighted searches
+ *	scale it afterwards, which keeps their cost within the weight of the optimal one.
+ */
+namespace nav_mesh {
+    inline float nav_distance(vec3_t a, vec3_t b) {
+        auto delta = a - b;
+        return sqrtf(delta.x * delta.x + delta.y * delta.y + delta.z * delta.z);
+    }
+
+    // center to center distance, the same costs MicroPather sees through AdjacentCost
+    struct nav_distance_cost {
+        nav_distance_cost(const nav_file& nav, const nav_path_options_t& options)
+            : m_centers(nav.m_area_centers.data()), m_clearances(nav.connections_clearance.data()),
+            m_kinds(nav.connections_kind.data()), m_extra_costs(nav.connections_extra_cost.data()),
+            m_min_width(options.min_width), m_use_ladders(options.use_ladders) { }
+
+        bool allows(std::size_t) const { return true; }
+
+        // connection indexes into nav_file::connections. the clearance of every connection is at least 0,
+        // so the default min_width never filters anything
+        bool allows_connection(std::size_t connection) const {
+            return m_clearances[connection] >= m_min_width && (m_use_ladders || m_kinds[connection] == nav_connection_kind::walk);
+        }
+
+        float get_step_cost(std::size_t from, std::size_t to) const {
+            return nav_distance(m_centers[from], m_centers[to]);
+        }
+
+        // the way along a ladder beyond the straight line between the centers, 0 for walk connections
+        float get_connection_cost(std::size_t connection) const { return m_extra_costs[connection]; }
+
+        float get_estimate(std::size_t from, std::size_t goal) const {
+            return nav_distance(m_centers[from], m_centers[goal]);
+        }
+
+        const vec3_t* m_centers;
+        const float* m_clearances;
+        const nav_connection_kind* m_kinds;
+        const float* m_extra_costs;
+        float m_min_width;
+        bool m_use_ladders;
+    };
+
+    // distance scaled by the attribute weights of the area being entered
+    struct nav_attribute_weighted_cost : nav_distance_cost {
+        nav_attribute_weighted_cost(const nav_file& nav, const nav_path_options_t& options)
+            : nav_distance_cost(nav, options), m_attributes(nav.m_area_attributes.data()), m_weights(options.attribute_weights) { }
+
+        float get_step_cost(std::size_t from, std::size_t to) const {
+            float scale = 1.f;
+            std::uint32_t attributes = m_attributes[to];
+
+            for (std::size_t i = 0; i < NAV_ATTRIBUTE_WEIGHT_COUNT; i++) {
+                if (attributes & m_weights[i].attributes)
+                    scale *= m_weights[i].scale;
+            }
+
+            return nav_distance_cost::get_step_cost(from, to) * scale;
+        }
+
+        const std::uint32_t* m_attributes;
+        const nav_attribute_weight_t* m_weights;
+    };
+
+    // travel time in seconds, half of each step is spent at the speed of either area
+    struct nav_time_cost : nav_distance_cost {
+        nav_time_cost(const nav_file& nav, const nav_path_options_t& options)
+            : nav_distance_cost(nav, options), m_attributes(nav.m_area_attributes.data()),
+            m_inv_run_speed(1.f / options.run_speed), m_inv_walk_speed(1.f / options.walk_speed),
+            m_inv_crouch_speed(1.f / options.crouch_speed) { }
+
+        float get_inv_speed(std::size_t area_index) const {
+            std::uint32_t attributes = m_attributes[area_index];
+
+            if (attributes & static_cast<std::uint32_t>(NavAttributeType::NAV_MESH_CROUCH))
+                return m_inv_crouch_speed;
+
+            if (attributes & static_cast<std::uint32_t>(NavAttributeType::NAV_MESH_WALK))
+                return m_inv_walk_speed;
+
+            return m_inv_run_speed;
+        }
+
+        float get_step_cost(std::size_t from, std::size_t to) const {
+            return nav_distance_cost::get_step_cost(from, to) * .5f * (get_inv_speed(from) + get_inv_speed(to));
+        }
+
+        // ladders are climbed at walking speed
+        float get_connection_cost(std::size_t connection) const {
+            return nav_distance_cost::get_connection_cost(connection) * m_inv_walk_speed;
+        }
+
+        float get_estimate(std::size_t from, std::size_t goal) const {
+            return nav_distance_cost::get_estimate(from, goal) * m_inv_run_speed;
+        }
+
+        const std::uint32_t* m_attributes;
+        float m_inv_run_speed, m_inv_walk_speed, m_inv_crouch_speed;
+    };
+
+    // applies a nav_cost_overlay on top of another profile, penalties are in that profile's units
+    template < typename base_cost >
+    struct nav_overlay_cost : base_cost {
+        nav_overlay_cost(const nav_file& nav, const nav_path_options_t& options)
+            : base_cost(nav, options), m_overlay(options.overlay), m_overlay_attributes(nav.m_area_attributes.data()) { }
+
+        bool allows(std::size_t area_index) const {
+            return m_overlay->allows(area_index, m_overlay_attributes[area_index]);
+        }
+
+        float get_step_cost(std::size_t from, std::size_t to) const {
+            return base_cost::get_step_cost(from, to) + m_overlay->get_entry_cost(to, m_overlay_attributes[to]);
+        }
+
+        const nav_cost_overlay* m_overlay;
+        const std::uint32_t* m_overlay_attributes;
+    };
+
+    // limits another policy to the areas of the nodes set in allowed_nodes, see nav_coarse_graph::find_corridor
+    template < typename base_cost >
+    struct nav_coarse_corridor_cost : base_cost {
+        nav_coarse_corridor_cost(const base_cost& base, const nav_coarse_graph& graph, const std::vector< std::uint64_t >& allowed_nodes)
+            : base_cost(base), m_area_nodes(graph.get_area_nodes()), m_allowed_nodes(allowed_nodes.data()) { }
+
+        bool allows(std::size_t area_index) const {
+            std::uint32_t node = m_area_nodes[area_index];
+            return ((m_allowed_nodes[node >> 6] >> (node & 63)) & 1) && base_cost::allows(area_index);
+        }
+
+        const std::uint32_t* m_area_nodes;
+        const std::uint64_t* m_allowed_nodes;
+    };
+
+    // sets up an A* from start to goal in context, which nav_search_astar_resume then runs
+    template < typename cost_policy >
+    void nav_search_astar_begin(const nav_file& nav, nav_search_context& context, std::size_t start, std::size_t goal,
+        const cost_policy& policy, float heuristic_weight = 1.f) {
+        context.begin(nav.m_areas.size());
+        context.m_heuristic_weight = heuristic_weight;
+        context.reach(start, 0.f, start);
+        context.push(heuristic_weight * policy.get_estimate(start, goal), start);
+        context.m_best = static_cast<std::uint32_t>(start);
+    }
+
+    // expands until the goal comes off the open list (solved), the open list runs dry (no_solution) or the
+    // budget runs out or either cancel flag is set (partial). context.m_best is kept up to date so a partial
+    // search can be turned into a path
+    template < typename cost_policy >
+    nav_path_status nav_search_astar_resume(const nav_file& nav, nav_search_context& context, std::size_t goal,
+        const cost_policy& policy, std::uint32_t max_expansions = 0,
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(),
+        const std::atomic< bool >* cancelled = nullptr, const std::atomic< bool >* request_cancelled = nullptr) {
+        bool has_deadline = deadline != std::chrono::steady_clock::time_point::max();
+        float heuristic_weight = context.m_heuristic_weight;
+        std::uint32_t expansions = 0;
+
+        while (context.has_open()) {
+            if (expansions == max_expansions && max_expansions != 0)
+                return nav_path_status::partial;
+
+            std::size_t area_index = context.pop().index;
+            if (context.is_closed(area_index))
+                continue;
+
+            if (area_index == goal) {
+                context.m_best = static_cast<std::uint32_t>(goal);
+                context.m_best_estimate = 0.f;
+                return nav_path_status::solved;
+            }
+
+            context.close(area_index);
+            context.m_expansions++;
+
+            float estimate = policy.get_estimate(area_index, goal);
+            if (estimate < context.m_best_estimate) {
+                context.m_best = static_cast<std::uint32_t>(area_index);
+                context.m_best_estimate = estimate;
+            }
+
+            float area_cost = context.get_cost(area_index);
+            std::size_t first = nav.connections_area_start[area_index],
+                last = first + nav.connections_area_length[area_index];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::size_t next_index = nav.connections[i];
+                if (context.is_closed(next_index) || !policy.allows_connection(i) || !policy.allows(next_index))
+                    continue;
+
+                float next_cost = area_cost + policy.get_step_cost(area_index, next_index) + policy.get_connection_cost(i);
+                if (next_cost < context.get_cost(next_index)) {
+                    context.reach(next_index, next_cost, area_index, i);
+                    context.push(next_cost + heuristic_weight * policy.get_estimate(next_index, goal), next_index);
+                }
+            }
+
+            // checked after expanding so every call makes progress, however late it is made
+            if (++expansions % NAV_DEADLINE_CHECK_INTERVAL == 0) {
+                if (cancelled && cancelled->load(std::memory_order_relaxed))
+                    return nav_path_status::partial;
+
+                if (request_cancelled && request_cancelled->load(std::memory_order_relaxed))
+                    return nav_path_status::partial;
+
+                if (has_deadline && std::chrono::steady_clock::now() >= deadline)
+                    return nav_path_status::partial;
+            }
+        }
+
+        return nav_path_status::no_solution;
+    }
+
+    // leaves the path in context.m_path if build_path is set, the cost is context.get_cost(goal) either way
+    template < typename cost_policy >
+    bool nav_search_astar(const nav_file& nav, nav_search_context& context, std::size_t start, std::size_t goal,
+        const cost_policy& policy, bool build_path = true, float heuristic_weight = 1.f) {
+        nav_search_astar_begin(nav, context, start, goal, policy, heuristic_weight);
+        if (nav_search_astar_resume(nav, context, goal, policy) != nav_path_status::solved)
+            return false;
+
+        if (build_path)
+            context.build_path(start, goal);
+
+        return true;
+    }
+
+    // Dijkstra from start that stops once every area in context.m_goals is closed, in any order and with repeats.
+    // NAV_INVALID_INDEX entries are skipped
+    template < typename cost_policy >
+    void nav_search_costs(const nav_file& nav, nav_search_context& context, std::size_t start, const cost_policy& policy) {
+        const std::vector< std::uint32_t >& goals = context.m_goals;
+        std::size_t open_goal = 0;
+
+        context.begin(nav.m_areas.size());
+        context.reach(start, 0.f, start);
+        context.push(0.f, start);
+
+        while (context.has_open()) {
+            // closed areas stay closed, so the first goal still open only ever moves forward
+            while (open_goal != goals.size() && (goals[open_goal] == NAV_INVALID_INDEX || context.is_closed(goals[open_goal])))
+                open_goal++;
+
+            if (open_goal == goals.size())
+                break;
+
+            nav_open_entry_t entry = context.pop();
+            std::size_t area_index = entry.index;
+            if (context.is_closed(area_index))
+                continue;
+
+            context.close(area_index);
+
+            std::size_t first = nav.connections_area_start[area_index],
+                last = first + nav.connections_area_length[area_index];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::size_t next_index = nav.connections[i];
+                if (context.is_closed(next_index) || !policy.allows_connection(i) || !policy.allows(next_index))
+                    continue;
+
+                float next_cost = entry.priority + policy.get_step_cost(area_index, next_index) + policy.get_connection_cost(i);
+                if (next_cost < context.get_cost(next_index)) {
+                    context.reach(next_index, next_cost, area_index, i);
+                    context.push(next_cost, next_index);
+                }
+            }
+        }
+    }
+
+    // Dijkstra from start that stops at the first area of context.m_goals (sorted, unique) it closes and returns
+    // it, NAV_INVALID_INDEX if none is reached within max_expansions (0 for no limit)
+    template < typename cost_policy >
+    std::uint32_t nav_search_nearest_goal(const nav_file& nav, nav_search_context& context, std::size_t start, const cost_policy& policy,
+        std::uint32_t max_expansions = 0) {
+        const std::vector< std::uint32_t >& goals = context.m_goals;
+
+        context.begin(nav.m_areas.size());
+        context.reach(start, 0.f, start);
+        context.push(0.f, start);
+
+        while (context.has_open()) {
+            nav_open_entry_t entry = context.pop();
+            std::size_t area_index = entry.index;
+            if (context.is_closed(area_index))
+                continue;
+
+            if (std::binary_search(goals.begin(), goals.end(), static_cast<std::uint32_t>(area_index)))
+                return static_cast<std::uint32_t>(area_index);
+
+            if (context.m_expansions == max_expansions && max_expansions != 0)
+                break;
+
+            context.close(area_index);
+            context.m_expansions++;
+
+            std::size_t first = nav.connections_area_start[area_index],
+                last = first + nav.connections_area_length[area_index];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::size_t next_index = nav.connections[i];
+                if (context.is_closed(next_index) || !policy.allows_connection(i) || !policy.allows(next_index))
+                    continue;
+
+                float next_cost = entry.priority + policy.get_step_cost(area_index, next_index) + policy.get_connection_cost(i);
+                if (next_cost < context.get_cost(next_index)) {
+                    context.reach(next_index, next_cost, area_index, i);
+                    context.push(next_cost, next_index);
+                }
+            }
+        }
+
+        return NAV_INVALID_INDEX;
+    }
+
+    // Dijkstra bounded by max_cost, appending every settled area in order of increasing cost
+    template < typename cost_policy >
+    void nav_search_within_cost(const nav_file& nav, nav_search_context& context, std::size_t start, float max_cost,
+        const cost_policy& policy, std::vector< nav_area_cost_t >& areas) {
+        context.begin(nav.m_areas.size());
+        context.reach(start, 0.f, start);
+        context.push(0.f, start);
+
+        while (context.has_open()) {
+            nav_open_entry_t entry = context.pop();
+            std::size_t area_index = entry.index;
+            if (context.is_closed(area_index))
+                continue;
+
+            context.close(area_index);
+            areas.push_back({ static_cast<std::uint32_t>(area_index), entry.priority });
+
+            std::size_t first = nav.connections_area_start[area_index],
+                last = first + nav.connections_area_length[area_index];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::size_t next_index = nav.connections[i];
+                if (context.is_closed(next_index) || !policy.allows_connection(i) || !policy.allows(next_index))
+                    continue;
+
+                float next_cost = entry.priority + policy.get_step_cost(area_index, next_index) + policy.get_connection_cost(i);
+                if (next_cost <= max_cost && next_cost < context.get_cost(next_index)) {
+                    context.reach(next_index, next_cost, area_index, i);
+                    context.push(next_cost, next_index);
+                }
+            }
+        }
+    }
+
+    /*
+     *	Backwards Dijkstra from every goal at once over the reverse connections, filling the per area
+     *	distance to the nearest goal and the area to move into next. An area that is not allowed by
+     *	the policy still gets a value (an agent may stand in it) but is never routed through.
+     */
+    template < typename cost_policy >
+    void nav_search_flow_field(const nav_file& nav, nav_search_context& context, nav_flow_field& field, float max_cost, const cost_policy& policy) {
+        field.resize(nav.m_areas.size());
+        context.begin(nav.m_areas.size());
+
+        float* distance = field.m_distance.data();
+        std::uint32_t* next = field.m_next.data();
+
+        for (std::uint32_t goal : field.m_goals) {
+            if (!policy.allows(goal) || distance[goal] == 0.f)
+                continue;
+
+            distance[goal] = 0.f;
+            context.push(0.f, goal);
+        }
+
+        while (context.has_open()) {
+            nav_open_entry_t entry = context.pop();
+            std::size_t area_index = entry.index;
+            if (entry.priority > distance[area_index] || !policy.allows(area_index))
+                continue;
+
+            std::size_t first = nav.reverse_connections_area_start[area_index],
+                last = first + nav.reverse_connections_area_length[area_index];
+
+            for (std::size_t i = first; i < last; i++) {
+                std::size_t source_index = nav.reverse_connections[i];
+                if (!policy.allows_connection(nav.reverse_connections_edge[i]))
+                    continue;
+
+                float source_cost = entry.priority + policy.get_step_cost(source_index, area_index) + policy.get_connection_cost(nav.reverse_connections_edge[i]);
+                if (source_cost < distance[source_index] && source_cost <= max_cost) {
+                    distance[source_index] = source_cost;
+                    next[source_index] = static_cast<std::uint32_t>(area_index);
+                    context.push(source_cost, source_index);
+                }
+            }
+        }
+    }
+
+    /*
+     *	Maps the runtime profile of the options onto the specialized policy types and calls
+     *	search(policy) with the matching one, so each profile runs its own instantiation.
+     */
+    template < typename search_fn >
+    auto nav_dispatch_cost_profile(const nav_file& nav, const nav_path_options_t& options, search_fn&& search) {
+        // below 1 is never useful, the search stays optimal and only gets slower
+        if (!(options.heuristic_weight >= 1.f))
+            throw std::runtime_error("nav_dispatch_cost_profile: heuristic weight below 1");
+
+        // either would let the distance estimate overestimate, voiding the bound of heuristic_weight.
+        // the per area penalties are checked as they are set, see nav_cost_overlay::set_penalty
+        if (options.profile == nav_cost_profile::attribute_weighted) {
+            for (const auto& weight : options.attribute_weights) {
+                if (weight.attributes != 0 && !(weight.scale >= 1.f))
+                    throw std::runtime_error("nav_dispatch_cost_profile: attribute weight scale below 1");
+            }
+        }
+
+        // the estimate assumes running all the way, so no area may be crossed faster
+        if (options.profile == nav_cost_profile::time) {
+            if (!(options.walk_speed > 0.f) || !(options.crouch_speed > 0.f))
+                throw std::runtime_error("nav_dispatch_cost_profile: speed not above 0");
+
+            if (!(options.run_speed >= options.walk_speed) || !(options.run_speed >= options.crouch_speed))
+                throw std::runtime_error("nav_dispatch_cost_profile: run speed below walk or crouch speed");
+        }
+
+        if (options.overlay) {
+            if (options.overlay->size() != nav.m_areas.size())
+                throw std::runtime_error("nav_dispatch_cost_profile: overlay size mismatch");
+
+            if (!(options.overlay->m_avoid_penalty >= 0.f))
+                throw std::runtime_error("nav_dispatch_cost_profile: negative avoid penalty");
+
+            switch (options.profile) {
+            case nav_cost_profile::attribute_weighted:
+                return search(nav_overlay_cost< nav_attribute_weighted_cost >(nav, options));
+            case nav_cost_profile::time:
+                return search(nav_overlay_cost< nav_time_cost >(nav, options));
+            default:
+                return search(nav_overlay_cost< nav_distance_cost >(nav, options));
+            }
+        }
+
+        switch (options.profile) {
+        case nav_cost_profile::attribute_weighted:
+            return search(nav_attribute_weighted_cost(nav, options));
+        case nav_cost_profile::time:
+            return search(nav_time_cost(nav, options));
+        default:
+            return search(nav_distance_cost(nav, options));
+        }
+    }
+}
@@ -57,6 +57,15 @@ namespace nav_mesh {
 		};
 	};
 
+	// the edge shared by two connected areas, oriented for travel from the source to the target area
+	struct nav_portal_t {
+		vec3_t left = { },
+			right = { },
+			middle = { };
+
+		float width = 0.f;
+	};
+
 	struct nav_ladder_connect_t {
 		nav_ladder_connect_t() { }
 		nav_ladder_connect_t(std::uint32_t connect_id) {
@@ -69,6 +78,24 @@ namespace nav_mesh {
 		};
 	};
 
+	// ladder record from after the areas of the nav file, areas are ids and 0 where there is none
+	struct nav_ladder_t {
+		std::uint32_t id = 0;
+		float width = 0.f;
+
+		vec3_t top = { },
+			bottom = { };
+
+		float length = 0.f;
+		std::uint32_t direction = 0;
+
+		std::uint32_t top_forward_area = 0,
+			top_left_area = 0,
+			top_right_area = 0,
+			top_behind_area = 0,
+			bottom_area = 0;
+	};
+
 	struct nav_spot_order_t {
 		float t = 0.f;
 
@@ -0,0 +1,207 @@
+#include "nav_tactical.h"
+#include "nav_file.h"
+#include <algorithm>
+#include <cmath>
+
+namespace nav_mesh {
+    void nav_tactical::build(const nav_file& nav) {
+        std::size_t area_count = nav.m_areas.size();
+
+        m_spots.clear();
+        for (std::size_t area_index = 0; area_index < area_count; area_index++) {
+            for (const auto& spot : nav.m_areas[area_index].m_hiding_spots)
+                m_spots.push_back({ spot.get_pos(), spot.get_id(), static_cast<std::uint32_t>(area_index), spot.get_flags() });
+        }
+
+        m_min_x = m_min_y = 0.f;
+        float max_x = 0.f, max_y = 0.f;
+        if (!m_spots.empty()) {
+            m_min_x = max_x = m_spots[0].pos.x;
+            m_min_y = max_y = m_spots[0].pos.y;
+        }
+
+        for (const auto& spot : m_spots) {
+            m_min_x = std::min(m_min_x, spot.pos.x);
+            m_min_y = std::min(m_min_y, spot.pos.y);
+            max_x = std::max(max_x, spot.pos.x);
+            max_y = std::max(max_y, spot.pos.y);
+        }
+
+        std::size_t max_cells = std::max< std::size_t >(1024, m_spots.size() * 4);
+        m_cell_size = NAV_TACTICAL_CELL_SIZE;
+        for (;;) {
+            m_cells_x = static_cast<std::size_t>((max_x - m_min_x) / m_cell_size) + 1;
+            m_cells_y = static_cast<std::size_t>((max_y - m_min_y) / m_cell_size) + 1;
+            if (m_cells_x * m_cells_y <= max_cells)
+                break;
+
+            m_cell_size *= 2.f;
+        }
+
+        // counting sort by cell, so every cell becomes a contiguous range
+        std::vector< std::size_t > spot_cells(m_spots.size());
+        m_cell_start.assign(m_cells_x * m_cells_y + 1, 0);
+        for (std::size_t i = 0; i < m_spots.size(); i++) {
+            spot_cells[i] = get_cell(m_spots[i].pos.x, m_spots[i].pos.y);
+            m_cell_start[spot_cells[i] + 1]++;
+        }
+
+        for (std::size_t i = 1; i < m_cell_start.size(); i++)
+            m_cell_start[i] += m_cell_start[i - 1];
+
+        std::vector< std::uint32_t > fill(m_cell_start.begin(), m_cell_start.end() - 1);
+        std::vector< nav_tactical_spot_t > sorted_spots(m_spots.size());
+        for (std::size_t i = 0; i < m_spots.size(); i++)
+            sorted_spots[fill[spot_cells[i]]++] = m_spots[i];
+
+        m_spots = std::move(sorted_spots);
+
+        m_spot_ids.clear();
+        for (std::size_t i = 0; i < m_spots.size(); i++)
+            m_spot_ids.push_back({ m_spots[i].id, static_cast<std::uint32_t>(i) });
+
+        std::sort(m_spot_ids.begin(), m_spot_ids.end());
+
+        // encounters, with the areas and spots they name resolved. unknown areas drop the encounter,
+        // unknown spots just the spot
+        m_encounters.clear();
+        m_encounter_spots.clear();
+        m_encounters_area_start.assign(area_count, 0);
+        m_encounters_area_length.assign(area_count, 0);
+
+        for (std::size_t area_index = 0; area_index < area_count; area_index++) {
+            m_encounters_area_start[area_index] = static_cast<std::uint32_t>(m_encounters.size());
+
+            for (const auto& encounter : nav.m_areas[area_index].m_spot_encounters) {
+                auto from = nav.m_area_ids_to_indices.find(encounter.from.id);
+                auto to = nav.m_area_ids_to_indices.find(encounter.to.id);
+                if (from == nav.m_area_ids_to_indices.end() || to == nav.m_area_ids_to_indices.end())
+                    continue;
+
+                nav_encounter_t resolved;
+                resolved.from_index = static_cast<std::uint32_t>(from->second);
+                resolved.to_index = static_cast<std::uint32_t>(to->second);
+                resolved.from_direction = encounter.from_direction;
+                resolved.to_direction = encounter.to_direction;
+                resolved.first_spot = static_cast<std::uint32_t>(m_encounter_spots.size());
+
+                for (const auto& order : encounter.spot_order) {
+                    std::uint32_t spot_index = get_spot_index(order.id);
+                    if (spot_index != NAV_INVALID_INDEX)
+                        m_encounter_spots.push_back({ spot_index, order.t });
+                }
+
+                resolved.spot_count = static_cast<std::uint32_t>(m_encounter_spots.size()) - resolved.first_spot;
+                m_encounters.push_back(resolved);
+            }
+
+            m_encounters_area_length[area_index] = static_cast<std::uint32_t>(m_encounters.size()) - m_encounters_area_start[area_index];
+        }
+    }
+
+    std::uint32_t nav_tactical::get_spot_index(std::uint32_t spot_id) const {
+        auto found = std::lower_bound(m_spot_ids.begin(), m_spot_ids.end(), std::make_pair(spot_id, std::uint32_t(0)));
+        if (found == m_spot_ids.end() || found->first != spot_id)
+            return NAV_INVALID_INDEX;
+
+        return found->second;
+    }
+
+    std::size_t nav_tactical::get_cell(float x, float y) const {
+        auto clamp_cell = [&](float offset, std::size_t cells) {
+            float cell = std::floor(offset / m_cell_size);
+            return cell <= 0.f ? std::size_t(0) : std::min(static_cast<std::size_t>(cell), cells - 1);
+        };
+
+        return clamp_cell(y - m_min_y, m_cells_y) * m_cells_x + clamp_cell(x - m_min_x, m_cells_x);
+    }
+
+    std::uint32_t nav_tactical::get_nearest_hidden_spot(vec3_t position, const std::uint64_t* visible,
+        float max_distance, std::uint8_t required_flags) const {
+        if (m_spots.empty())
+            return NAV_INVALID_INDEX;
+
+        std::size_t cell = get_cell(position.x, position.y);
+        std::ptrdiff_t cell_x = static_cast<std::ptrdiff_t>(cell % m_cells_x),
+            cell_y = static_cast<std::ptrdiff_t>(cell / m_cells_x);
+
+        std::uint32_t nearest = NAV_INVALID_INDEX;
+        float nearest_distance = max_distance;
+
+        auto visit_cell = [&](std::ptrdiff_t x, std::ptrdiff_t y) {
+            if (x < 0 || y < 0 || x >= static_cast<std::ptrdiff_t>(m_cells_x) || y >= static_cast<std::ptrdiff_t>(m_cells_y))
+                return;
+
+            std::size_t visit = static_cast<std::size_t>(y) * m_cells_x + static_cast<std::size_t>(x);
+            for (std::uint32_t i = m_cell_start[visit]; i < m_cell_start[visit + 1]; i++) {
+                const nav_tactical_spot_t& spot = m_spots[i];
+                if ((spot.flags & required_flags) != required_flags || nav_visibility::is_set(visible, spot.area_index))
+                    continue;
+
+                float dx = spot.pos.x - position.x, dy = spot.pos.y - position.y, dz = spot.pos.z - position.z;
+                float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+                if (distance <= nearest_distance) {
+                    nearest_distance = distance;
+                    nearest = i;
+                }
+            }
+        };
+
+        // rings of cells around the start cell, anything past ring r is at least r cells away
+        std::ptrdiff_t max_ring = static_cast<std::ptrdiff_t>(std::max(m_cells_x, m_cells_y));
+        for (std::ptrdiff_t ring = 0; ring <= max_ring; ring++) {
+            if (ring == 0) {
+                visit_cell(cell_x, cell_y);
+            }
+            else {
+                for (std::ptrdiff_t i = -ring; i <= ring; i++) {
+                    visit_cell(cell_x + i, cell_y - ring);
+                    visit_cell(cell_x + i, cell_y + ring);
+                }
+
+                for (std::ptrdiff_t i = -ring + 1; i <= ring - 1; i++) {
+                    visit_cell(cell_x - ring, cell_y + i);
+                    visit_cell(cell_x + ring, cell_y + i);
+                }
+            }
+
+            if (static_cast<float>(ring) * m_cell_size >= nearest_distance)
+                break;
+        }
+
+        return nearest;
+    }
+
+    const nav_encounter_spot_t* nav_tactical::get_encounter_spots(std::size_t area_index, std::size_t from_index, std::size_t to_index,
+        std::size_t& count) const {
+        std::size_t first = m_encounters_area_start[area_index],
+            last = first + m_encounters_area_length[area_index];
+
+        for (std::size_t i = first; i < last; i++) {
+            const nav_encounter_t& encounter = m_encounters[i];
+            if (encounter.from_index == from_index && encounter.to_index == to_index) {
+                count = encounter.spot_count;
+                return m_encounter_spots.data() + encounter.first_spot;
+            }
+        }
+
+        count = 0;
+        return nullptr;
+    }
+
+    void nav_tactical::get_spots_along_path(const std::uint32_t* area_indices, std::size_t count, std::vector< std::uint32_t >& spots) const {
+        spots.clear();
+
+        // encounters are stored on the area being crossed, keyed on the areas before and after it
+        for (std::size_t i = 1; i + 1 < count; i++) {
+            std::size_t spot_count = 0;
+            const nav_encounter_spot_t* encounter_spots = get_encounter_spots(area_indices[i], area_indices[i - 1], area_indices[i + 1], spot_count);
+
+            for (std::size_t j = 0; j < spot_count; j++) {
+                // paths see a few dozen spots at most, a linear check beats any set
+                if (std::find(spots.begin(), spots.end(), encounter_spots[j].spot_index) == spots.end())
+                    spots.push_back(encounter_spots[j].spot_index);
+            }
+        }
+    }
+}
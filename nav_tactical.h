@@ -0,0 +1,87 @@
+#pragma once
+#include "nav_query.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace nav_mesh {
+    class nav_file;
+
+    struct nav_tactical_spot_t {
+        vec3_t pos = { };
+        std::uint32_t id = 0;
+        // dense index of the area the spot belongs to
+        std::uint32_t area_index = 0;
+        // nav_hiding_spot_flags
+        std::uint8_t flags = 0;
+    };
+
+    struct nav_encounter_spot_t {
+        std::uint32_t spot_index;
+        // how far along the way through the area the spot comes into view, 0 to 1
+        float t;
+    };
+
+    // one spot encounter of an area, for passing through it from from_index to to_index
+    struct nav_encounter_t {
+        std::uint32_t from_index,
+            to_index;
+
+        std::uint8_t from_direction,
+            to_direction;
+
+        // range of m_encounter_spots
+        std::uint32_t first_spot,
+            spot_count;
+    };
+
+    // cell size of the spatial grid over the spots, doubled on huge sparse maps to keep the grid small
+    constexpr float NAV_TACTICAL_CELL_SIZE = 256.f;
+
+    /*
+     *	Hiding spots and spot encounters of every area, flattened and resolved to dense indices at
+     *	load. Spots are stored sorted by the cell of a uniform 2d grid they fall in, so each cell is
+     *	a contiguous range of m_spots and nearest spot queries only look at the cells around them.
+     *	Encounters are grouped by area like the connection arrays.
+     */
+    class nav_tactical {
+    public:
+        void build(const nav_file& nav);
+
+        const std::vector< nav_tactical_spot_t >& get_spots() const { return m_spots; }
+        // NAV_INVALID_INDEX for unknown ids
+        std::uint32_t get_spot_index(std::uint32_t spot_id) const;
+
+        // nearest spot to position within max_distance whose area is not set in the visible bitset (a row or a
+        // combination of rows of nav_visibility), having all of required_flags. NAV_INVALID_INDEX if there is none
+        std::uint32_t get_nearest_hidden_spot(vec3_t position, const std::uint64_t* visible,
+            float max_distance = FLT_MAX, std::uint8_t required_flags = 0) const;
+
+        // spots seen while crossing area_index from from_index to to_index, in the order they come into view
+        const nav_encounter_spot_t* get_encounter_spots(std::size_t area_index, std::size_t from_index, std::size_t to_index,
+            std::size_t& count) const;
+        // every spot encountered along a sequence of areas, each spot once, in the order first seen
+        void get_spots_along_path(const std::uint32_t* area_indices, std::size_t count, std::vector< std::uint32_t >& spots) const;
+
+        std::vector< nav_tactical_spot_t > m_spots = { };
+        std::vector< nav_encounter_t > m_encounters = { };
+        std::vector< nav_encounter_spot_t > m_encounter_spots = { };
+        std::vector< std::uint32_t > m_encounters_area_start = { },
+            m_encounters_area_length = { };
+
+    private:
+        std::size_t get_cell(float x, float y) const;
+
+        float m_min_x = 0.f,
+            m_min_y = 0.f,
+            m_cell_size = NAV_TACTICAL_CELL_SIZE;
+
+        std::size_t m_cells_x = 0,
+            m_cells_y = 0;
+
+        // spots of cell i are m_spots[m_cell_start[i], m_cell_start[i + 1])
+        std::vector< std::uint32_t > m_cell_start = { };
+        // (id, index) sorted by id, for get_spot_index
+        std::vector< std::pair< std::uint32_t, std::uint32_t > > m_spot_ids = { };
+    };
+}
@@ -0,0 +1,88 @@
+#include "nav_visibility.h"
+#include "nav_file.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NAV_VISIBILITY_SSE2
+#endif
+
+namespace nav_mesh {
+    void nav_visibility::build(const nav_file& nav) {
+        std::size_t area_count = nav.m_areas.size();
+        m_row_words = ((area_count + 63) / 64 + NAV_VISIBILITY_ROW_ALIGNMENT - 1) / NAV_VISIBILITY_ROW_ALIGNMENT * NAV_VISIBILITY_ROW_ALIGNMENT;
+        m_rows.assign(area_count * m_row_words, 0);
+
+        auto apply = [&](std::uint64_t* row, const std::vector< nav_area_bind_info_t >& visible_areas) {
+            for (const auto& info : visible_areas) {
+                auto found = nav.m_area_ids_to_indices.find(info.id);
+                if (found == nav.m_area_ids_to_indices.end())
+                    continue;
+
+                std::uint64_t bit = std::uint64_t(1) << (found->second & 63);
+                if (info.attributes != 0)
+                    row[found->second >> 6] |= bit;
+                else
+                    row[found->second >> 6] &= ~bit;
+            }
+        };
+
+        for (std::size_t area_index = 0; area_index < area_count; area_index++) {
+            const nav_area& area = nav.m_areas[area_index];
+            std::uint64_t* row = m_rows.data() + area_index * m_row_words;
+
+            // inherited first, so the area's own entries get the last word
+            auto inherited = nav.m_area_ids_to_indices.find(area.m_inherit_visibility_from.id);
+            if (area.m_inherit_visibility_from.id != 0 && inherited != nav.m_area_ids_to_indices.end())
+                apply(row, nav.m_areas[inherited->second].m_potentially_visible_areas);
+
+            apply(row, area.m_potentially_visible_areas);
+
+            // nav files don't list an area as visible from itself, but it always is
+            row[area_index >> 6] |= std::uint64_t(1) << (area_index & 63);
+        }
+    }
+
+    void nav_visibility::get_visible_from_any(const std::vector< std::uint32_t >& area_indices, std::vector< std::uint64_t >& visible) const {
+        visible.assign(m_row_words, 0);
+
+        for (std::uint32_t area_index : area_indices) {
+            const std::uint64_t* row = get_row(area_index);
+
+#ifdef NAV_VISIBILITY_SSE2
+            for (std::size_t i = 0; i < m_row_words; i += 2) {
+                __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(visible.data() + i));
+                bits = _mm_or_si128(bits, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(visible.data() + i), bits);
+            }
+#else
+            for (std::size_t i = 0; i < m_row_words; i++)
+                visible[i] |= row[i];
+#endif
+        }
+    }
+
+    void nav_visibility::get_visible_from_all(const std::vector< std::uint32_t >& area_indices, std::vector< std::uint64_t >& visible) const {
+        if (area_indices.empty()) {
+            visible.assign(m_row_words, 0);
+            return;
+        }
+
+        const std::uint64_t* first_row = get_row(area_indices.front());
+        visible.assign(first_row, first_row + m_row_words);
+
+        for (std::size_t j = 1; j < area_indices.size(); j++) {
+            const std::uint64_t* row = get_row(area_indices[j]);
+
+#ifdef NAV_VISIBILITY_SSE2
+            for (std::size_t i = 0; i < m_row_words; i += 2) {
+                __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(visible.data() + i));
+                bits = _mm_and_si128(bits, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(visible.data() + i), bits);
+            }
+#else
+            for (std::size_t i = 0; i < m_row_words; i++)
+                visible[i] &= row[i];
+#endif
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace nav_mesh {
+    class nav_file;
+
+    // rows are padded to a multiple of this many words so bulk operations always run on full vectors
+    constexpr std::size_t NAV_VISIBILITY_ROW_ALIGNMENT = 4;
+
+    /*
+     *	Potentially visible sets as one bitset row per area, indexed like m_areas. Built once at load
+     *	from the per area lists of the nav file, with inherited visibility already merged in: an area
+     *	sees what the area it inherits from lists, unless its own list says otherwise. Every area
+     *	sees itself.
+     */
+    class nav_visibility {
+    public:
+        void build(const nav_file& nav);
+
+        bool is_potentially_visible(std::size_t from, std::size_t to) const {
+            return (m_rows[from * m_row_words + (to >> 6)] >> (to & 63)) & 1;
+        }
+
+        const std::uint64_t* get_row(std::size_t area_index) const { return m_rows.data() + area_index * m_row_words; }
+        std::size_t get_row_words() const { return m_row_words; }
+
+        // bitset of the areas potentially visible from at least one / every one of the given areas.
+        // visible is resized to get_row_words() words, no areas leaves it empty of bits
+        void get_visible_from_any(const std::vector< std::uint32_t >& area_indices, std::vector< std::uint64_t >& visible) const;
+        void get_visible_from_all(const std::vector< std::uint32_t >& area_indices, std::vector< std::uint64_t >& visible) const;
+
+        static bool is_set(const std::uint64_t* bits, std::size_t area_index) {
+            return (bits[area_index >> 6] >> (area_index & 63)) & 1;
+        }
+
+        static bool is_set(const std::vector< std::uint64_t >& bits, std::size_t area_index) { return is_set(bits.data(), area_index); }
+
+    private:
+        std::size_t m_row_words = 0;
+        std::vector< std::uint64_t > m_rows = { };
+    };
+}